@@ -36,14 +36,18 @@ class uBitAddr:
     LTC = 1
     ETH = 2
     DGB = 3
+    BTC_TAPROOT = 4
 
     # Initialize the object with a desired output and entropy source
-    def __init__(self, output=OUTPUT_DISPLAY, entropy_source=ENTROPY_CRNG, currency=BTCBCH, bch=False):
+    # The compressed flag uses compressed public keys for BTC, BCH, LTC and DGB,
+    # with the matching compressed WIF private key
+    def __init__(self, output=OUTPUT_DISPLAY, entropy_source=ENTROPY_CRNG, currency=BTCBCH, bch=False, compressed=False):
 
         self.output = output
         self.entropy_source = entropy_source
         self.currency = currency
         self.bch = bch
+        self.compressed = compressed
 
         if currency == self.ETH:
             self.privkey_format = "(HEX)"
@@ -81,13 +85,15 @@ class uBitAddr:
     def generate_address_privkey(self):
 
         if self.currency == self.LTC:
-            address, privkey = bitaddr.get_address_ltc(self.get_entropy_str(), self.get_entropy_str())
+            address, privkey = bitaddr.get_address_ltc(self.get_entropy_str(), self.get_entropy_str(), self.compressed)
         elif self.currency == self.ETH:
             address, privkey = bitaddr.get_address_eth(self.get_entropy_str(), self.get_entropy_str())
         elif self.currency == self.DGB:
-            address, privkey = bitaddr.get_address_dgb(self.get_entropy_str(), self.get_entropy_str())
+            address, privkey = bitaddr.get_address_dgb(self.get_entropy_str(), self.get_entropy_str(), self.compressed)
+        elif self.currency == self.BTC_TAPROOT:
+            address, privkey = bitaddr.get_address_taproot(self.get_entropy_str(), self.get_entropy_str())
         else:
-            address, privkey = bitaddr.get_address(self.get_entropy_str(), self.get_entropy_str(), self.bch)
+            address, privkey = bitaddr.get_address(self.get_entropy_str(), self.get_entropy_str(), self.bch, self.compressed)
 
         # Strip extra buffer garbage
         # The buffer is currently 70 characters on the C side to be safe,
@@ -99,6 +105,11 @@ class uBitAddr:
         if self.currency == self.ETH:
             address = address[:42]
             privkey = privkey[:66]
+        elif self.currency == self.BTC_TAPROOT:
+            # Taproot addresses are always 62 characters, and the
+            # private key carries the compressed key flag
+            address = address[:62]
+            privkey = privkey[:52]
         else:
             if self.bch:
                 address = address.replace("bitcoincash:", "")
@@ -106,7 +117,11 @@ class uBitAddr:
             else:
                 address = address[:34]
 
-            privkey = privkey[:51]
+            # Compressed WIF keys carry an extra flag byte
+            if self.compressed:
+                privkey = privkey[:52]
+            else:
+                privkey = privkey[:51]
 
         return (address, privkey)
 
@@ -166,7 +181,11 @@ class uBitAddr:
         while True:
             lcd.clear()
             address = self.prep_data(address, cols)
-            lcd.message = "Address:\n" + address
+            # A taproot address takes all 4 rows, leave out the header
+            if self.currency == self.BTC_TAPROOT:
+                lcd.message = address
+            else:
+                lcd.message = "Address:\n" + address
 
             time.sleep(self.DISPLAY_INTERVAL)
 
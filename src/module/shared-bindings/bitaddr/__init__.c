@@ -21,18 +21,20 @@ const size_t PRIVKEY_STR_LENGTH = 70;
 //|
 //|   Returns a Bitcoin or Bitcoin Cash Legacy Address, or a Bitcoin Cash CashAddr address
 //|   with a WIF encoded private key
+//|   The optional compressed flag uses a compressed public key
 //|
-STATIC mp_obj_t bitaddr_get_address(mp_obj_t entropy_privkey, mp_obj_t entropy_ecdsa, mp_obj_t bch) {
+STATIC mp_obj_t bitaddr_get_address(size_t n_args, const mp_obj_t *args) {
 
 	// Convert entropy args needed for secure address generation
-	const char* entropy_privkey_char = mp_obj_str_get_str(entropy_privkey);
-	const char* entropy_ecdsa_char = mp_obj_str_get_str(entropy_ecdsa);
-	int bch_flag = mp_obj_get_int(bch);
+	const char* entropy_privkey_char = mp_obj_str_get_str(args[0]);
+	const char* entropy_ecdsa_char = mp_obj_str_get_str(args[1]);
+	int bch_flag = mp_obj_get_int(args[2]);
+	int compressed_flag = n_args > 3 ? mp_obj_get_int(args[3]) : 0;
 
 	// Create an address cstring long enough to fit any Bitcoin address
 	unsigned char address[ADDRESS_STR_LENGTH];
 	unsigned char privkey[PRIVKEY_STR_LENGTH];
- 	shared_modules_bitaddr_get_address_privkey(address, privkey, entropy_privkey_char, entropy_ecdsa_char, bch_flag);
+ 	shared_modules_bitaddr_get_address_privkey(address, privkey, entropy_privkey_char, entropy_ecdsa_char, bch_flag, compressed_flag);
 
     	// make the return value
     	mp_obj_tuple_t *addr_key= MP_OBJ_TO_PTR(mp_obj_new_tuple(2, NULL));
@@ -41,22 +43,24 @@ STATIC mp_obj_t bitaddr_get_address(mp_obj_t entropy_privkey, mp_obj_t entropy_e
 
 	return addr_key;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_3(bitaddr_get_address_obj, bitaddr_get_address);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bitaddr_get_address_obj, 3, 4, bitaddr_get_address);
 
 //| .. function:: get_address_privkey_ltc
 //|
 //|   Returns a Litecoin address and WIF encoded private key
+//|   The optional compressed flag uses a compressed public key
 //|
-STATIC mp_obj_t bitaddr_get_address_ltc(mp_obj_t entropy_privkey, mp_obj_t entropy_ecdsa) {
+STATIC mp_obj_t bitaddr_get_address_ltc(size_t n_args, const mp_obj_t *args) {
 
 	// Convert entropy args needed for secure address generation
-	const char* entropy_privkey_char = mp_obj_str_get_str(entropy_privkey);
-	const char* entropy_ecdsa_char = mp_obj_str_get_str(entropy_ecdsa);
+	const char* entropy_privkey_char = mp_obj_str_get_str(args[0]);
+	const char* entropy_ecdsa_char = mp_obj_str_get_str(args[1]);
+	int compressed_flag = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
 
 	// Create an address cstring long enough to fit any Litecoin address
 	unsigned char address[ADDRESS_STR_LENGTH];
 	unsigned char privkey[PRIVKEY_STR_LENGTH];
- 	shared_modules_bitaddr_get_address_privkey_ltc(address, privkey, entropy_privkey_char, entropy_ecdsa_char);
+ 	shared_modules_bitaddr_get_address_privkey_ltc(address, privkey, entropy_privkey_char, entropy_ecdsa_char, compressed_flag);
 
     	// make the return value
     	mp_obj_tuple_t *addr_key= MP_OBJ_TO_PTR(mp_obj_new_tuple(2, NULL));
@@ -65,23 +69,25 @@ STATIC mp_obj_t bitaddr_get_address_ltc(mp_obj_t entropy_privkey, mp_obj_t entro
 
 	return addr_key;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(bitaddr_get_address_ltc_obj, bitaddr_get_address_ltc);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bitaddr_get_address_ltc_obj, 2, 3, bitaddr_get_address_ltc);
 
 
 //| .. function:: get_address_privkey_dgb
 //|
 //|   Returns a Digibyte address and WIF encoded private key
+//|   The optional compressed flag uses a compressed public key
 //|
-STATIC mp_obj_t bitaddr_get_address_dgb(mp_obj_t entropy_privkey, mp_obj_t entropy_ecdsa) {
+STATIC mp_obj_t bitaddr_get_address_dgb(size_t n_args, const mp_obj_t *args) {
 
 	// Convert entropy args needed for secure address generation
-	const char* entropy_privkey_char = mp_obj_str_get_str(entropy_privkey);
-	const char* entropy_ecdsa_char = mp_obj_str_get_str(entropy_ecdsa);
+	const char* entropy_privkey_char = mp_obj_str_get_str(args[0]);
+	const char* entropy_ecdsa_char = mp_obj_str_get_str(args[1]);
+	int compressed_flag = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
 
 	// Create an address cstring long enough to fit any Digibyte address
 	unsigned char address[ADDRESS_STR_LENGTH];
 	unsigned char privkey[PRIVKEY_STR_LENGTH];
- 	shared_modules_bitaddr_get_address_privkey_dgb(address, privkey, entropy_privkey_char, entropy_ecdsa_char);
+ 	shared_modules_bitaddr_get_address_privkey_dgb(address, privkey, entropy_privkey_char, entropy_ecdsa_char, compressed_flag);
 
     	// make the return value
     	mp_obj_tuple_t *addr_key= MP_OBJ_TO_PTR(mp_obj_new_tuple(2, NULL));
@@ -90,7 +96,7 @@ STATIC mp_obj_t bitaddr_get_address_dgb(mp_obj_t entropy_privkey, mp_obj_t entro
 
 	return addr_key;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(bitaddr_get_address_dgb_obj, bitaddr_get_address_dgb);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bitaddr_get_address_dgb_obj, 2, 3, bitaddr_get_address_dgb);
 
 //| .. function:: get_address_privkey_eth
 //|
@@ -116,11 +122,38 @@ STATIC mp_obj_t bitaddr_get_address_eth(mp_obj_t entropy_privkey, mp_obj_t entro
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(bitaddr_get_address_eth_obj, bitaddr_get_address_eth);
 
+//| .. function:: get_address_privkey_taproot
+//|
+//|   Returns a Bitcoin Taproot (P2TR) bech32m address and WIF encoded private key
+//|
+STATIC mp_obj_t bitaddr_get_address_taproot(mp_obj_t entropy_privkey, mp_obj_t entropy_ecdsa) {
+
+	// Convert entropy args needed for secure address generation
+	const char* entropy_privkey_char = mp_obj_str_get_str(entropy_privkey);
+	const char* entropy_ecdsa_char = mp_obj_str_get_str(entropy_ecdsa);
+
+	// Create an address cstring long enough to fit any Taproot address
+	unsigned char address[ADDRESS_STR_LENGTH];
+	unsigned char privkey[PRIVKEY_STR_LENGTH];
+	if (!shared_modules_bitaddr_get_address_privkey_taproot(address, privkey, entropy_privkey_char, entropy_ecdsa_char)) {
+		mp_raise_RuntimeError(translate("taproot address generation failed"));
+	}
+
+    	// make the return value
+    	mp_obj_tuple_t *addr_key= MP_OBJ_TO_PTR(mp_obj_new_tuple(2, NULL));
+    	addr_key -> items[0] = mp_obj_new_str((char*) address, ADDRESS_STR_LENGTH);
+    	addr_key -> items[1] = mp_obj_new_str((char*) privkey, PRIVKEY_STR_LENGTH);
+
+	return addr_key;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(bitaddr_get_address_taproot_obj, bitaddr_get_address_taproot);
+
 STATIC const mp_rom_map_elem_t mp_module_bitaddr_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_get_address), MP_ROM_PTR(&bitaddr_get_address_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_address_ltc), MP_ROM_PTR(&bitaddr_get_address_ltc_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_address_dgb), MP_ROM_PTR(&bitaddr_get_address_dgb_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_address_eth), MP_ROM_PTR(&bitaddr_get_address_eth_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_address_taproot), MP_ROM_PTR(&bitaddr_get_address_taproot_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_bitaddr_globals, mp_module_bitaddr_globals_table);
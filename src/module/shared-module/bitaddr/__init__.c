@@ -12,6 +12,8 @@
 #include "rand.h"
 #include "base58.h"
 #include "cash_addr.h"
+#include "schnorr.h"
+#include "segwit_addr.h"
 
 #include <stdio.h>
 
@@ -19,6 +21,7 @@
 size_t RAW_ADDRESS_NOCHECK_LENGTH = 21;
 size_t RAW_ADDRESS_CHECK_LENGTH = 25;
 size_t PUBKEY_65_LENGTH = 65;
+size_t PUBKEY_33_LENGTH = 33;
 size_t CHECKSUM_LENGTH = 4;
 size_t ADDRESS_LENGTH = 40;
 size_t ETH_PUBKEY_LENGTH = 64;
@@ -28,6 +31,8 @@ size_t RAW_PRIVKEY_NOCHECK_LENGTH = 33;
 size_t RAW_PRIVKEY_CHECK_LENGTH = 37;
 size_t PRIVKEY_WIF_LENGTH = 70;
 size_t PRIVKEY_HEX_LENGTH = 66;
+size_t PUBKEY_XONLY_LENGTH = 32;
+size_t TAPROOT_ADDRESS_LENGTH = 63;
 
 // Version bit data
 // The defines are taken from Trezor examples
@@ -39,6 +44,10 @@ unsigned char LTC_ADDR_PREFIX = 0x30;
 unsigned char LTC_WIF_PREFIX = 0xB0;
 unsigned char DGB_ADDR_PREFIX = 0x1E;
 unsigned char DGB_WIF_PREFIX = 0x80;
+unsigned char PRIVKEY_COMPRESSED_FLAG = 0x01;
+#define TAPROOT_WITNESS_VERSION (1)
+#define TAPROOT_KEY_ATTEMPTS (4)
+const char* BTC_SEGWIT_HRP = "bc";
 
 // Define helper functions that aren't directly accessible to Python
 
@@ -68,6 +77,13 @@ void pubkey_from_privkey(unsigned char privkey[SHA256_DIGEST_LENGTH],  unsigned
                             (uint8_t*) pubkey);
 }
 
+// Calculate the compressed secp256k1 public key from the private key
+// The 0x02/0x03 prefix gives the parity of y, followed by the 32 byte x coordinate
+void compressed_pubkey_from_privkey(unsigned char privkey[SHA256_DIGEST_LENGTH],  unsigned char pubkey[PUBKEY_33_LENGTH])
+{
+	ecdsa_get_public_key33(&secp256k1, (uint8_t*) privkey, (uint8_t*) pubkey);
+}
+
 // Generate a private key from some entropy
 void privkey_from_entropy(const char* entropy, unsigned char privkey[SHA256_DIGEST_LENGTH])
 {
@@ -75,13 +91,15 @@ void privkey_from_entropy(const char* entropy, unsigned char privkey[SHA256_DIGE
 }
 
 // Generate address from pubkey
-void address_from_pubkey(const unsigned char pubkey[PUBKEY_65_LENGTH], unsigned char version_prefix, unsigned char address[ADDRESS_LENGTH])
+// The pubkey is either 65 bytes uncompressed or 33 bytes compressed
+// A compressed key fits in one SHA-256 block, so it hashes with one compression instead of two
+void address_from_pubkey(const unsigned char* pubkey, size_t pubkey_length, unsigned char version_prefix, unsigned char address[ADDRESS_LENGTH])
 {
 	// First, "double hash" the public key
 	unsigned char round_1[SHA256_DIGEST_LENGTH];
 	unsigned char round_2[RIPEMD160_DIGEST_LENGTH];
 
-	sha256_Raw((uint8_t*) pubkey, PUBKEY_65_LENGTH, (uint8_t*) round_1);
+	sha256_Raw((uint8_t*) pubkey, pubkey_length, (uint8_t*) round_1);
 	ripemd160((uint8_t*) round_1, SHA256_DIGEST_LENGTH, (uint8_t*) round_2);
 
 	// Add the version specifier
@@ -108,7 +126,9 @@ void address_from_pubkey(const unsigned char pubkey[PUBKEY_65_LENGTH], unsigned
 	memcpy(raw_address_check + RAW_ADDRESS_NOCHECK_LENGTH, checksum, CHECKSUM_LENGTH);
 
 	// Base58 encode
-	b58enc((char*) address, &ADDRESS_LENGTH, raw_address_check, RAW_ADDRESS_CHECK_LENGTH);
+	// b58enc writes the encoded length back, so give it a copy of the buffer size
+	size_t address_length = ADDRESS_LENGTH;
+	b58enc((char*) address, &address_length, raw_address_check, RAW_ADDRESS_CHECK_LENGTH);
 }
 
 // Generate address from pubkey
@@ -133,13 +153,14 @@ void eth_address_from_pubkey(const unsigned char pubkey[PUBKEY_65_LENGTH], unsig
 }
 
 // Generate address from pubkey
-void cash_address_from_pubkey(const unsigned char pubkey[PUBKEY_65_LENGTH], unsigned char address[ADDRESS_LENGTH])
+// The pubkey is either 65 bytes uncompressed or 33 bytes compressed
+void cash_address_from_pubkey(const unsigned char* pubkey, size_t pubkey_length, unsigned char address[ADDRESS_LENGTH])
 {
 	// First, "double hash" the public key
 	unsigned char round_1[SHA256_DIGEST_LENGTH];
 	unsigned char round_2[RIPEMD160_DIGEST_LENGTH];
 
-	sha256_Raw((uint8_t*) pubkey, PUBKEY_65_LENGTH, (uint8_t*) round_1);
+	sha256_Raw((uint8_t*) pubkey, pubkey_length, (uint8_t*) round_1);
 	ripemd160((uint8_t*) round_1, SHA256_DIGEST_LENGTH, (uint8_t*) round_2);
 
 	// Add the version specifier
@@ -151,6 +172,21 @@ void cash_address_from_pubkey(const unsigned char pubkey[PUBKEY_65_LENGTH], unsi
 	cash_addr_encode((char*) address, "bitcoincash", raw_address_nocheck, RAW_ADDRESS_NOCHECK_LENGTH);
 }
 
+// Generate a P2TR (taproot) address from the private key
+// The x-only public key is tweaked with its TapTweak hash for a key path only output (BIP341)
+// The output key is the version 1 witness program, encoded with bech32m (BIP350)
+// Returns 0 if the private key is not a valid secp256k1 key or the encoding fails
+int taproot_address_from_privkey(const unsigned char privkey[SHA256_DIGEST_LENGTH], const char* hrp, unsigned char address[TAPROOT_ADDRESS_LENGTH])
+{
+	unsigned char output_key[PUBKEY_XONLY_LENGTH];
+	if (!schnorr_get_tweaked_public_key((const uint8_t*) privkey, (uint8_t*) output_key))
+	{
+		return 0;
+	}
+
+	return segwit_addr_encode((char*) address, hrp, TAPROOT_WITNESS_VERSION, (uint8_t*) output_key, PUBKEY_XONLY_LENGTH);
+}
+
 void privkey_hex_from_raw(unsigned char* privkey_raw, unsigned char* privkey)
 {
 	privkey[0] = '0';
@@ -163,20 +199,23 @@ void privkey_hex_from_raw(unsigned char* privkey_raw, unsigned char* privkey)
 	}
 }
 
-void privkey_wif_from_raw(unsigned char* privkey_raw, unsigned char version_prefix, unsigned char* privkey)
+void privkey_wif_from_raw(unsigned char* privkey_raw, unsigned char version_prefix, int compressed, unsigned char* privkey)
 {
 	
 	// Add the version specifierd
-	unsigned char raw_privkey_nocheck[RAW_PRIVKEY_NOCHECK_LENGTH];
+	// Keys for compressed public keys get the 0x01 compression flag after the key data
+	size_t raw_privkey_nocheck_length = RAW_PRIVKEY_NOCHECK_LENGTH + (compressed ? 1 : 0);
+	unsigned char raw_privkey_nocheck[RAW_PRIVKEY_NOCHECK_LENGTH + 1];
 	raw_privkey_nocheck[0] = version_prefix;
 	memcpy(raw_privkey_nocheck + 1, privkey_raw, SHA256_DIGEST_LENGTH);
+	raw_privkey_nocheck[RAW_PRIVKEY_NOCHECK_LENGTH] = PRIVKEY_COMPRESSED_FLAG;
 
 	// Generate a checksum
 	unsigned char check_round_1[SHA256_DIGEST_LENGTH];
 	unsigned char check_round_2[SHA256_DIGEST_LENGTH];
 	unsigned char checksum[CHECKSUM_LENGTH];
 
-	sha256_Raw((uint8_t*) raw_privkey_nocheck, RAW_PRIVKEY_NOCHECK_LENGTH, check_round_1);
+	sha256_Raw((uint8_t*) raw_privkey_nocheck, raw_privkey_nocheck_length, check_round_1);
 	sha256_Raw((uint8_t*) check_round_1, SHA256_DIGEST_LENGTH, check_round_2);
 	memcpy(checksum, check_round_2, CHECKSUM_LENGTH);
 
@@ -184,13 +223,16 @@ void privkey_wif_from_raw(unsigned char* privkey_raw, unsigned char version_pref
 	// Finalize the raw WIF format privkey
 	// 1 byte for the version string - 0x80 for mainneti BTC/BCH
 	// 32 bytes for the raw private key data
+	// 1 byte for the compression flag, if set
 	// 4 bytes for the checksum
-	unsigned char raw_privkey_check[RAW_PRIVKEY_CHECK_LENGTH];
-	memcpy(raw_privkey_check, raw_privkey_nocheck, RAW_PRIVKEY_NOCHECK_LENGTH);
-	memcpy(raw_privkey_check + RAW_PRIVKEY_NOCHECK_LENGTH, checksum, CHECKSUM_LENGTH);
+	unsigned char raw_privkey_check[RAW_PRIVKEY_CHECK_LENGTH + 1];
+	memcpy(raw_privkey_check, raw_privkey_nocheck, raw_privkey_nocheck_length);
+	memcpy(raw_privkey_check + raw_privkey_nocheck_length, checksum, CHECKSUM_LENGTH);
 
 	// Base58 encode
-	b58enc((char*) privkey, &PRIVKEY_WIF_LENGTH, raw_privkey_check, RAW_PRIVKEY_CHECK_LENGTH);
+	// b58enc writes the encoded length back, so give it a copy of the buffer size
+	size_t privkey_length = PRIVKEY_WIF_LENGTH;
+	b58enc((char*) privkey, &privkey_length, raw_privkey_check, raw_privkey_nocheck_length + CHECKSUM_LENGTH);
 }
 
 
@@ -198,7 +240,8 @@ void privkey_wif_from_raw(unsigned char* privkey_raw, unsigned char version_pref
 
 // The default API get_address_privkey returns a keypair for Bitcoin (BTC) and/or Bitcoin Cash (BCH)
 // The bch flag can be set to use CashAddr format instead of the cross-compatible/legacy base58check format
-void shared_modules_bitaddr_get_address_privkey(unsigned char* address, unsigned char* privkey, const char* entropy_privkey, const char* entropy_ecdsa, int bch)
+// The compressed flag selects a compressed public key, and a WIF private key with the compression flag
+void shared_modules_bitaddr_get_address_privkey(unsigned char* address, unsigned char* privkey, const char* entropy_privkey, const char* entropy_ecdsa, int bch, int compressed)
 {
 	// Init the random32 for rand.h and ecdsa.h functions
 	// The random function is only needed for curve_to_jacobian - needs a random k value
@@ -214,27 +257,36 @@ void shared_modules_bitaddr_get_address_privkey(unsigned char* address, unsigned
 	privkey_from_entropy(entropy_privkey, privkey_raw);
 
 	unsigned char pubkey[PUBKEY_65_LENGTH];
-	pubkey_from_privkey(privkey_raw, pubkey);
+	size_t pubkey_length = PUBKEY_65_LENGTH;
+	if (compressed)
+	{
+		compressed_pubkey_from_privkey(privkey_raw, pubkey);
+		pubkey_length = PUBKEY_33_LENGTH;
+	}
+	else
+	{
+		pubkey_from_privkey(privkey_raw, pubkey);
+	}
 
 	// Generate the address from the public key
 	// This address can use the legacy base58check encoding valid
 	// in both BTC and BCH, or BCH cashaddr
 	if (bch)
 	{
-		cash_address_from_pubkey(pubkey, address);
+		cash_address_from_pubkey(pubkey, pubkey_length, address);
 	}
 	else
 	{
-		address_from_pubkey(pubkey, BTC_ADDR_PREFIX, address);
+		address_from_pubkey(pubkey, pubkey_length, BTC_ADDR_PREFIX, address);
 	}
 
 	// Convert the private key to WIF format for export
-	privkey_wif_from_raw(privkey_raw, BTC_WIF_PREFIX, privkey);
+	privkey_wif_from_raw(privkey_raw, BTC_WIF_PREFIX, compressed, privkey);
 }
 
 // This function generates a keypair for Litecoin, with the same steps as BTC. The only difference is the address version prefix and WIF privkey version prefix
 // Although this code is copy-pasted from above and could be refactored, I want to have a one-to-one mapping from the Python API to the underlying module code here
-void shared_modules_bitaddr_get_address_privkey_ltc(unsigned char* address, unsigned char* privkey, const char* entropy_privkey, const char* entropy_ecdsa)
+void shared_modules_bitaddr_get_address_privkey_ltc(unsigned char* address, unsigned char* privkey, const char* entropy_privkey, const char* entropy_ecdsa, int compressed)
 {
 	// Init the random32 for rand.h and ecdsa.h functions
 	// The random function is only needed for curve_to_jacobian - needs a random k value
@@ -250,17 +302,26 @@ void shared_modules_bitaddr_get_address_privkey_ltc(unsigned char* address, unsi
 	privkey_from_entropy(entropy_privkey, privkey_raw);
 
 	unsigned char pubkey[PUBKEY_65_LENGTH];
-	pubkey_from_privkey(privkey_raw, pubkey);
+	size_t pubkey_length = PUBKEY_65_LENGTH;
+	if (compressed)
+	{
+		compressed_pubkey_from_privkey(privkey_raw, pubkey);
+		pubkey_length = PUBKEY_33_LENGTH;
+	}
+	else
+	{
+		pubkey_from_privkey(privkey_raw, pubkey);
+	}
 
-	address_from_pubkey(pubkey, LTC_ADDR_PREFIX, address);
+	address_from_pubkey(pubkey, pubkey_length, LTC_ADDR_PREFIX, address);
 
 	// Convert the private key to WIF format for export
-	privkey_wif_from_raw(privkey_raw, LTC_WIF_PREFIX, privkey);
+	privkey_wif_from_raw(privkey_raw, LTC_WIF_PREFIX, compressed, privkey);
 }
 
 
 // This function generates a keypair for Digibyte, with the same steps as BTC. The only difference is the address version prefix and WIF privkey version prefix
-void shared_modules_bitaddr_get_address_privkey_dgb(unsigned char* address, unsigned char* privkey, const char* entropy_privkey, const char* entropy_ecdsa)
+void shared_modules_bitaddr_get_address_privkey_dgb(unsigned char* address, unsigned char* privkey, const char* entropy_privkey, const char* entropy_ecdsa, int compressed)
 {
 	// Init the random32 for rand.h and ecdsa.h functions
 	// The random function is only needed for curve_to_jacobian - needs a random k value
@@ -276,12 +337,21 @@ void shared_modules_bitaddr_get_address_privkey_dgb(unsigned char* address, unsi
 	privkey_from_entropy(entropy_privkey, privkey_raw);
 
 	unsigned char pubkey[PUBKEY_65_LENGTH];
-	pubkey_from_privkey(privkey_raw, pubkey);
+	size_t pubkey_length = PUBKEY_65_LENGTH;
+	if (compressed)
+	{
+		compressed_pubkey_from_privkey(privkey_raw, pubkey);
+		pubkey_length = PUBKEY_33_LENGTH;
+	}
+	else
+	{
+		pubkey_from_privkey(privkey_raw, pubkey);
+	}
 
-	address_from_pubkey(pubkey, DGB_ADDR_PREFIX, address);
+	address_from_pubkey(pubkey, pubkey_length, DGB_ADDR_PREFIX, address);
 
 	// Convert the private key to WIF format for export
-	privkey_wif_from_raw(privkey_raw, DGB_WIF_PREFIX, privkey);
+	privkey_wif_from_raw(privkey_raw, DGB_WIF_PREFIX, compressed, privkey);
 }
 
 // This function generates a keypair for Ethereum
@@ -309,3 +379,39 @@ void shared_modules_bitaddr_get_address_privkey_eth(unsigned char* address, unsi
 	privkey_hex_from_raw(privkey_raw, privkey);
 }
 
+// This function generates a keypair for a Bitcoin P2TR (taproot) address
+// The private key is WIF encoded with the compression flag, since taproot keys are never uncompressed
+// Returns 0 if no valid key and address could be generated
+int shared_modules_bitaddr_get_address_privkey_taproot(unsigned char* address, unsigned char* privkey, const char* entropy_privkey, const char* entropy_ecdsa)
+{
+	// Init the random32 for rand.h and ecdsa.h functions
+	// The random function is only needed for curve_to_jacobian - needs a random k value
+	// It will only be called once for address generation, so we'll use true entropy
+	// To "seed" random32's PRNG without causing problems
+	unsigned char seed_entropy[SHA256_DIGEST_LENGTH];
+	sha256_Raw((uint8_t*) entropy_ecdsa, strlen(entropy_ecdsa), (uint8_t*) seed_entropy);
+	init_random32(seed_entropy);
+
+	// Generate the private key from some entropy
+	// Then generate the tweaked taproot output key and its address
+	unsigned char privkey_raw[SHA256_DIGEST_LENGTH];
+	privkey_from_entropy(entropy_privkey, privkey_raw);
+
+	// A hash of zero or above the curve order is not a valid key, with odds of about 2^-128
+	// Rehash the key until it is valid rather than handing out an address that can't be spent
+	// If it still fails, report the failure instead of an address without its key
+	int attempt = 0;
+	while (!taproot_address_from_privkey(privkey_raw, BTC_SEGWIT_HRP, address))
+	{
+		if (++attempt == TAPROOT_KEY_ATTEMPTS)
+		{
+			memset(privkey_raw, 0, SHA256_DIGEST_LENGTH);
+			return 0;
+		}
+		sha256_Raw((uint8_t*) privkey_raw, SHA256_DIGEST_LENGTH, (uint8_t*) privkey_raw);
+	}
+
+	// Convert the private key to WIF format for export
+	privkey_wif_from_raw(privkey_raw, BTC_WIF_PREFIX, 1, privkey);
+	return 1;
+}
@@ -36,6 +36,16 @@ typedef struct {
   uint32_t val[9];
 } bignum256;
 
+// one step of an addition chain, see bn_pow_chain
+typedef struct {
+  uint8_t dst, src, squarings, mul;
+} bn_chain_step;
+
+// number of temporaries available to an addition chain
+#define BN_CHAIN_SLOTS 8
+// marks a chain step without multiplication
+#define BN_CHAIN_NONE 0xFF
+
 // read 4 big endian bytes into uint32
 uint32_t read_be(const uint8_t *data);
 
@@ -97,6 +107,8 @@ int bn_is_less(const bignum256 *a, const bignum256 *b);
 
 int bn_is_equal(const bignum256 *a, const bignum256 *b);
 
+int bn_is_magnitude(const bignum256 *a, uint32_t m, const bignum256 *prime);
+
 void bn_cmov(bignum256 *res, int cond, const bignum256 *truecase,
              const bignum256 *falsecase);
 
@@ -118,14 +130,31 @@ void bn_mult_k(bignum256 *x, uint8_t k, const bignum256 *prime);
 
 void bn_mod(bignum256 *x, const bignum256 *prime);
 
+int bn_is_secp256k1_prime(const bignum256 *prime);
+
+void bn_multiply_long(const bignum256 *k, const bignum256 *x,
+                      uint32_t res[18]);
+
 void bn_multiply(const bignum256 *k, bignum256 *x, const bignum256 *prime);
 
+void bn_square(bignum256 *x, const bignum256 *prime);
+
+void bn_multiply_secp256k1(const bignum256 *k, bignum256 *x);
+
+void bn_square_secp256k1(bignum256 *x);
+
 void bn_fast_mod(bignum256 *x, const bignum256 *prime);
 
+void bn_pow_chain(bignum256 *x, const bn_chain_step *chain, size_t len,
+                  const bignum256 *prime);
+
 void bn_sqrt(bignum256 *x, const bignum256 *prime);
 
 void bn_inverse(bignum256 *x, const bignum256 *prime);
 
+void bn_inverse_batch(bignum256 *x, bignum256 *acc, size_t n,
+                      const bignum256 *prime);
+
 void bn_normalize(bignum256 *a);
 
 void bn_add(bignum256 *a, const bignum256 *b);
@@ -0,0 +1,392 @@
+/**
+ * Copyright (c) 2013-2014 Tomas Dzetkulic
+ * Copyright (c) 2013-2014 Pavol Rusnak
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "bignum_x4.h"
+#include "memzero.h"
+
+#if USE_BN_X4
+
+#include <assert.h>
+#include <string.h>
+
+// The functions in this file work lane by lane exactly like their
+// counterparts in bignum.c.  The limbs are stored in 64 bit words, so
+// the linear functions are simple loops over the four lanes that the
+// compiler turns into vector code.  The multiplication is the only
+// expensive operation; it has an AVX2 implementation for the secp256k1
+// prime that is selected at runtime and falls back to bn_multiply.
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define BN_X4_HAVE_AVX2 1
+#define BN_X4_AVX2 __attribute__((target("avx2")))
+#else
+#define BN_X4_HAVE_AVX2 0
+#endif
+
+#if BN_X4_HAVE_AVX2
+// checks the cpu once, the result never changes afterwards.  Threads
+// racing on the first call all store the same value.
+static int bn_x4_has_avx2(void) {
+  static int has_avx2 = -1;
+  int r = __atomic_load_n(&has_avx2, __ATOMIC_RELAXED);
+  if (r < 0) {
+    __builtin_cpu_init();
+    r = __builtin_cpu_supports("avx2") != 0;
+    __atomic_store_n(&has_avx2, r, __ATOMIC_RELAXED);
+  }
+  return r;
+}
+#endif
+
+int bn_x4_is_accelerated(const bignum256 *prime) {
+#if BN_X4_HAVE_AVX2
+  return bn_x4_has_avx2() && bn_is_secp256k1_prime(prime);
+#else
+  (void)prime;
+  return 0;
+#endif
+}
+
+void bn_x4_set_lane(bignum256x4 *x, int lane, const bignum256 *a) {
+  int i;
+  for (i = 0; i < 9; i++) {
+    x->val[i][lane] = a->val[i];
+  }
+}
+
+void bn_x4_get_lane(const bignum256x4 *x, int lane, bignum256 *a) {
+  int i;
+  for (i = 0; i < 9; i++) {
+    a->val[i] = (uint32_t)x->val[i][lane];
+  }
+}
+
+void bn_zero_x4(bignum256x4 *a) { memset(a, 0, sizeof(*a)); }
+
+// returns the lanes where a == b.
+// a must be normalized.
+int bn_is_equal_x4(const bignum256x4 *a, const bignum256 *b) {
+  int i, j, result = 0;
+  uint64_t diff[4] = {0};
+  for (i = 0; i < 9; i++) {
+    for (j = 0; j < 4; j++) {
+      diff[j] |= a->val[i][j] ^ b->val[i];
+    }
+  }
+  for (j = 0; j < 4; j++) {
+    result |= (diff[j] == 0) << j;
+  }
+  return result;
+}
+
+// Assigns res = cond ? truecase : falsecase lane by lane.
+// function is constant time.
+void bn_cmov_x4(bignum256x4 *res, int cond, const bignum256x4 *truecase,
+                const bignum256x4 *falsecase) {
+  int i, j;
+  uint64_t tmask[4];
+
+  assert((cond & ~BN_X4_ALL_LANES) == 0);
+  for (j = 0; j < 4; j++) {
+    tmask[j] = -(uint64_t)((cond >> j) & 1);
+  }
+  for (i = 0; i < 9; i++) {
+    for (j = 0; j < 4; j++) {
+      res->val[i][j] = (truecase->val[i][j] & tmask[j]) |
+                       (falsecase->val[i][j] & ~tmask[j]);
+    }
+  }
+}
+
+// multiply x by 1/2 modulo prime, see bn_mult_half.
+// assumes x is normalized.
+// if x was partly reduced, it is also partly reduced on exit.
+void bn_mult_half_x4(bignum256x4 *x, const bignum256 *prime) {
+  int i, j;
+  uint64_t xodd[4], tmp1[4], tmp2;
+  for (j = 0; j < 4; j++) {
+    xodd[j] = -(x->val[0][j] & 1);
+    tmp1[j] = (x->val[0][j] + (prime->val[0] & xodd[j])) >> 1;
+  }
+  for (i = 0; i < 8; i++) {
+    for (j = 0; j < 4; j++) {
+      tmp2 = x->val[i + 1][j] + (prime->val[i + 1] & xodd[j]);
+      tmp1[j] += (tmp2 & 1) << 29;
+      x->val[i][j] = tmp1[j] & 0x3fffffff;
+      tmp1[j] >>= 30;
+      tmp1[j] += tmp2 >> 1;
+    }
+  }
+  for (j = 0; j < 4; j++) {
+    x->val[8][j] = tmp1[j];
+  }
+}
+
+// multiply x by k modulo prime.
+// assumes x is normalized, 0 <= k <= 4.
+// guarantees x is partly reduced.
+void bn_mult_k_x4(bignum256x4 *x, uint8_t k, const bignum256 *prime) {
+  int i, j;
+  for (i = 0; i < 9; i++) {
+    for (j = 0; j < 4; j++) {
+      x->val[i][j] *= k;
+    }
+  }
+  bn_fast_mod_x4(x, prime);
+}
+
+#if BN_X4_HAVE_AVX2
+
+// auxiliary function for multiplication.
+// compute res = k * x in all four lanes.
+// assumes k and x normalized, guarantees res normalized 18 limbs.
+// Every column is a sum of at most nine 60 bit products, so it
+// fits into the 64 bit lanes without overflow.
+BN_X4_AVX2 static inline void bn_multiply_long_avx2(const bignum256x4 *k,
+                                                    const bignum256x4 *x,
+                                                    __m256i res[18]) {
+  const __m256i mask = _mm256_set1_epi64x(0x3FFFFFFF);
+  __m256i kv[9], xv[9], acc, carry = _mm256_setzero_si256();
+  int i, j;
+
+  for (i = 0; i < 9; i++) {
+    kv[i] = _mm256_load_si256((const __m256i *)k->val[i]);
+    xv[i] = _mm256_load_si256((const __m256i *)x->val[i]);
+  }
+  for (i = 0; i < 17; i++) {
+    acc = carry;
+    for (j = (i < 8 ? 0 : i - 8); j <= (i < 8 ? i : 8); j++) {
+      acc = _mm256_add_epi64(acc, _mm256_mul_epu32(kv[j], xv[i - j]));
+    }
+    res[i] = _mm256_and_si256(acc, mask);
+    carry = _mm256_srli_epi64(acc, 30);
+  }
+  res[17] = carry;
+}
+
+// auxiliary function for multiplication.
+// compute res = x * x in all four lanes.
+// assumes x normalized, guarantees res normalized 18 limbs.
+BN_X4_AVX2 static inline void bn_square_long_avx2(const bignum256x4 *x,
+                                                  __m256i res[18]) {
+  const __m256i mask = _mm256_set1_epi64x(0x3FFFFFFF);
+  __m256i xv[9], acc, carry = _mm256_setzero_si256();
+  int i, j;
+
+  for (i = 0; i < 9; i++) {
+    xv[i] = _mm256_load_si256((const __m256i *)x->val[i]);
+  }
+  for (i = 0; i < 17; i++) {
+    acc = _mm256_setzero_si256();
+    // every cross product x[j] * x[i - j] with j < i - j appears twice
+    for (j = (i < 8 ? 0 : i - 8); 2 * j < i; j++) {
+      acc = _mm256_add_epi64(acc, _mm256_mul_epu32(xv[j], xv[i - j]));
+    }
+    acc = _mm256_slli_epi64(acc, 1);
+    if ((i & 1) == 0) {
+      acc = _mm256_add_epi64(acc, _mm256_mul_epu32(xv[i / 2], xv[i / 2]));
+    }
+    acc = _mm256_add_epi64(acc, carry);
+    res[i] = _mm256_and_si256(acc, mask);
+    carry = _mm256_srli_epi64(acc, 30);
+  }
+  res[17] = carry;
+}
+
+// auxiliary function for multiplication.
+// reduces x = res modulo the secp256k1 prime in all four lanes.
+// This is the same two step folding with 2^256 = 2^32 + 977 (mod p)
+// as in bn_multiply_reduce_secp256k1.
+// assumes    res normalized, res < 2^540
+// guarantees x partly reduced, i.e., x < 2 * prime
+BN_X4_AVX2 static inline void bn_multiply_reduce_avx2(bignum256x4 *x,
+                                                      __m256i res[18]) {
+  const __m256i mask = _mm256_set1_epi64x(0x3FFFFFFF);
+  const __m256i mask16 = _mm256_set1_epi64x(0xFFFF);
+  const __m256i c977 = _mm256_set1_epi64x(977);
+  __m256i hi[10], t[11], h[3], temp = _mm256_setzero_si256();
+  int i;
+
+  // hi = res >> 256
+  for (i = 0; i < 9; i++) {
+    hi[i] = _mm256_or_si256(
+        _mm256_srli_epi64(res[i + 8], 16),
+        _mm256_and_si256(_mm256_slli_epi64(res[i + 9], 14), mask));
+  }
+  hi[9] = _mm256_srli_epi64(res[17], 16);
+
+  // t = (res % 2^256) + hi * (2^32 + 977)
+  for (i = 0; i < 11; i++) {
+    if (i < 8) {
+      temp = _mm256_add_epi64(temp, res[i]);
+    } else if (i == 8) {
+      temp = _mm256_add_epi64(temp, _mm256_and_si256(res[8], mask16));
+    }
+    if (i < 10) {
+      temp = _mm256_add_epi64(temp, _mm256_mul_epu32(hi[i], c977));
+    }
+    if (i > 0) {
+      temp = _mm256_add_epi64(temp, _mm256_slli_epi64(hi[i - 1], 2));
+    }
+    t[i] = _mm256_and_si256(temp, mask);
+    temp = _mm256_srli_epi64(temp, 30);
+  }
+
+  // fold once more: h = t >> 256 < 2^62
+  h[0] = _mm256_or_si256(_mm256_srli_epi64(t[8], 16),
+                         _mm256_and_si256(_mm256_slli_epi64(t[9], 14), mask));
+  h[1] = _mm256_or_si256(_mm256_srli_epi64(t[9], 16),
+                         _mm256_and_si256(_mm256_slli_epi64(t[10], 14), mask));
+  h[2] = _mm256_srli_epi64(t[10], 16);
+  t[8] = _mm256_and_si256(t[8], mask16);
+  temp = _mm256_setzero_si256();
+  for (i = 0; i < 9; i++) {
+    temp = _mm256_add_epi64(temp, t[i]);
+    if (i < 3) {
+      temp = _mm256_add_epi64(temp, _mm256_mul_epu32(h[i], c977));
+    }
+    if (i > 0 && i < 4) {
+      temp = _mm256_add_epi64(temp, _mm256_slli_epi64(h[i - 1], 2));
+    }
+    _mm256_store_si256((__m256i *)x->val[i], _mm256_and_si256(temp, mask));
+    temp = _mm256_srli_epi64(temp, 30);
+  }
+}
+
+BN_X4_AVX2 static void bn_multiply_x4_avx2(const bignum256x4 *k,
+                                           bignum256x4 *x) {
+  __m256i res[18];
+  bn_multiply_long_avx2(k, x, res);
+  bn_multiply_reduce_avx2(x, res);
+  memzero(res, sizeof(res));
+}
+
+BN_X4_AVX2 static void bn_square_x4_avx2(bignum256x4 *x) {
+  __m256i res[18];
+  bn_square_long_avx2(x, res);
+  bn_multiply_reduce_avx2(x, res);
+  memzero(res, sizeof(res));
+}
+
+#endif
+
+// Compute x := k * x  (mod prime) lane by lane, see bn_multiply.
+// both inputs must be smaller than 180 * prime.
+// result is partly reduced (0 <= x < 2 * prime)
+void bn_multiply_x4(const bignum256x4 *k, bignum256x4 *x,
+                    const bignum256 *prime) {
+  int j;
+  bignum256 a, b;
+
+#if BN_X4_HAVE_AVX2
+  if (bn_x4_is_accelerated(prime)) {
+    bn_multiply_x4_avx2(k, x);
+    return;
+  }
+#endif
+  for (j = 0; j < 4; j++) {
+    bn_x4_get_lane(k, j, &a);
+    bn_x4_get_lane(x, j, &b);
+    bn_multiply(&a, &b, prime);
+    bn_x4_set_lane(x, j, &b);
+  }
+  memzero(&a, sizeof(a));
+  memzero(&b, sizeof(b));
+}
+
+// Compute x := x * x  (mod prime) lane by lane, see bn_square.
+// the input must be smaller than 180 * prime.
+// result is partly reduced (0 <= x < 2 * prime)
+void bn_square_x4(bignum256x4 *x, const bignum256 *prime) {
+  int j;
+  bignum256 a;
+
+#if BN_X4_HAVE_AVX2
+  if (bn_x4_is_accelerated(prime)) {
+    bn_square_x4_avx2(x);
+    return;
+  }
+#endif
+  for (j = 0; j < 4; j++) {
+    bn_x4_get_lane(x, j, &a);
+    bn_square(&a, prime);
+    bn_x4_set_lane(x, j, &a);
+  }
+  memzero(&a, sizeof(a));
+}
+
+// partly reduce x modulo prime lane by lane, see bn_fast_mod.
+// input x does not have to be normalized.
+// result is partly reduced, smaller than 2*prime
+void bn_fast_mod_x4(bignum256x4 *x, const bignum256 *prime) {
+  int i, j;
+  uint64_t coef[4], temp[4];
+
+  for (j = 0; j < 4; j++) {
+    coef[j] = x->val[8][j] >> 16;
+    temp[j] = 0x2000000000000000ull + x->val[0][j] - prime->val[0] * coef[j];
+    x->val[0][j] = temp[j] & 0x3FFFFFFF;
+  }
+  for (i = 1; i < 9; i++) {
+    for (j = 0; j < 4; j++) {
+      temp[j] >>= 30;
+      temp[j] +=
+          0x1FFFFFFF80000000ull + x->val[i][j] - prime->val[i] * coef[j];
+      x->val[i][j] = temp[j] & 0x3FFFFFFF;
+    }
+  }
+}
+
+// add two numbers a = a + b lane by lane
+// assumes that a, b are normalized
+// guarantees that a is normalized
+void bn_add_x4(bignum256x4 *a, const bignum256x4 *b) {
+  int i, j;
+  uint64_t tmp[4] = {0};
+  for (i = 0; i < 9; i++) {
+    for (j = 0; j < 4; j++) {
+      tmp[j] += a->val[i][j] + b->val[i][j];
+      a->val[i][j] = tmp[j] & 0x3FFFFFFF;
+      tmp[j] >>= 30;
+    }
+  }
+}
+
+// res = a - b mod prime lane by lane.  More exactly res = a + (2*prime - b).
+// b must be a partly reduced number
+// result is normalized but not reduced.
+void bn_subtractmod_x4(const bignum256x4 *a, const bignum256x4 *b,
+                       bignum256x4 *res, const bignum256 *prime) {
+  int i, j;
+  uint64_t temp[4] = {1, 1, 1, 1};
+  for (i = 0; i < 9; i++) {
+    for (j = 0; j < 4; j++) {
+      temp[j] += 0x3FFFFFFF + a->val[i][j] + 2u * prime->val[i] - b->val[i][j];
+      res->val[i][j] = temp[j] & 0x3FFFFFFF;
+      temp[j] >>= 30;
+    }
+  }
+}
+
+#endif
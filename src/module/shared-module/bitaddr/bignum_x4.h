@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2013-2014 Tomas Dzetkulic
+ * Copyright (c) 2013-2014 Pavol Rusnak
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __BIGNUM_X4_H__
+#define __BIGNUM_X4_H__
+
+#include <stdint.h>
+#include "bignum.h"
+#include "options.h"
+
+#if USE_BN_X4
+
+// four independent bignum256 in structure of arrays layout.
+// val[i][j] is the 30 bit limb i of lane j, stored in a 64 bit word so
+// that one AVX2 register holds limb i of all four lanes.
+typedef struct {
+  uint64_t val[9][4] __attribute__((aligned(32)));
+} bignum256x4;
+
+// lane masks are ints where bit j selects lane j
+#define BN_X4_ALL_LANES 0xF
+
+// returns nonzero if the AVX2 code is used for the given prime
+int bn_x4_is_accelerated(const bignum256 *prime);
+
+void bn_x4_set_lane(bignum256x4 *x, int lane, const bignum256 *a);
+
+void bn_x4_get_lane(const bignum256x4 *x, int lane, bignum256 *a);
+
+void bn_zero_x4(bignum256x4 *a);
+
+int bn_is_equal_x4(const bignum256x4 *a, const bignum256 *b);
+
+void bn_cmov_x4(bignum256x4 *res, int cond, const bignum256x4 *truecase,
+                const bignum256x4 *falsecase);
+
+void bn_mult_half_x4(bignum256x4 *x, const bignum256 *prime);
+
+void bn_mult_k_x4(bignum256x4 *x, uint8_t k, const bignum256 *prime);
+
+void bn_multiply_x4(const bignum256x4 *k, bignum256x4 *x,
+                    const bignum256 *prime);
+
+void bn_square_x4(bignum256x4 *x, const bignum256 *prime);
+
+void bn_fast_mod_x4(bignum256x4 *x, const bignum256 *prime);
+
+void bn_add_x4(bignum256x4 *a, const bignum256x4 *b);
+
+void bn_subtractmod_x4(const bignum256x4 *a, const bignum256x4 *b,
+                       bignum256x4 *res, const bignum256 *prime);
+
+#endif
+
+#endif
@@ -31,8 +31,19 @@
 #include "ecdsa.h"
 #include "memzero.h"
 #include "rand.h"
+#include "scalar.h"
+#include "rfc6979.h"
 #include "secp256k1.h"
 
+#if USE_RUNTIME_CP
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sha2.h"
+#endif
+
 // Set cp2 = cp1
 void point_copy(const curve_point *cp1, curve_point *cp2) { *cp2 = *cp1; }
 
@@ -64,7 +75,7 @@ void point_add(const ecdsa_curve *curve, const curve_point *cp1,
 
   // xr = lambda^2 - x1 - x2
   xr = lambda;
-  bn_multiply(&xr, &xr, &curve->prime);
+  bn_square(&xr, &curve->prime);
   yr = cp1->x;
   bn_addmod(&yr, &(cp2->x), &curve->prime);
   bn_subtractmod(&xr, &yr, &xr, &curve->prime);
@@ -100,14 +111,14 @@ void point_double(const ecdsa_curve *curve, curve_point *cp) {
   bn_inverse(&lambda, &curve->prime);
 
   xr = cp->x;
-  bn_multiply(&xr, &xr, &curve->prime);
+  bn_square(&xr, &curve->prime);
   bn_mult_k(&xr, 3, &curve->prime);
   bn_subi(&xr, -curve->a, &curve->prime);
   bn_multiply(&xr, &lambda, &curve->prime);
 
   // xr = lambda^2 - 2*x
   xr = lambda;
-  bn_multiply(&xr, &xr, &curve->prime);
+  bn_square(&xr, &curve->prime);
   yr = cp->x;
   bn_lshift(&yr);
   bn_subtractmod(&xr, &yr, &xr, &curve->prime);
@@ -174,29 +185,24 @@ void conditional_negate(uint32_t cond, bignum256 *a, const bignum256 *prime) {
   assert(a->val[8] < 0x20000);
 }
 
-typedef struct jacobian_curve_point {
-  bignum256 x, y, z;
-} jacobian_curve_point;
-
 // generate random K for signing/side-channel noise
-static void generate_k_random(bignum256 *k, const bignum256 *prime) {
+static void generate_k_random(bignum256 *k, const bignum256 *prime,
+                              random_ctx *rng) {
   do {
     int i;
     for (i = 0; i < 8; i++) {
-      k->val[i] = random32() & 0x3FFFFFFF;
+      k->val[i] = random32_ctx(rng) & 0x3FFFFFFF;
     }
-    k->val[8] = random32() & 0xFFFF;
+    k->val[8] = random32_ctx(rng) & 0xFFFF;
     // check that k is in range and not zero.
   } while (bn_is_zero(k) || !bn_is_less(k, prime));
 }
 
-void curve_to_jacobian(const curve_point *p, jacobian_curve_point *jp,
-                       const bignum256 *prime) {
-  // randomize z coordinate
-  generate_k_random(&jp->z, prime);
-
+// convert p to jacobian coordinates over the z already set in jp->z
+static void curve_to_jacobian_z(const curve_point *p, jacobian_curve_point *jp,
+                                const bignum256 *prime) {
   jp->x = jp->z;
-  bn_multiply(&jp->z, &jp->x, prime);
+  bn_square(&jp->x, prime);
   // x = z^2
   jp->y = jp->x;
   bn_multiply(&jp->z, &jp->y, prime);
@@ -206,13 +212,19 @@ void curve_to_jacobian(const curve_point *p, jacobian_curve_point *jp,
   bn_multiply(&p->y, &jp->y, prime);
 }
 
-void jacobian_to_curve(const jacobian_curve_point *jp, curve_point *p,
+void curve_to_jacobian(const curve_point *p, jacobian_curve_point *jp,
                        const bignum256 *prime) {
-  p->y = jp->z;
-  bn_inverse(&p->y, prime);
+  // randomize z coordinate
+  generate_k_random(&jp->z, prime, random_default_ctx());
+  curve_to_jacobian_z(p, jp, prime);
+}
+
+// convert jp to affine coordinates, where p->y already holds z^-1
+static void jacobian_to_curve_zinv(const jacobian_curve_point *jp,
+                                   curve_point *p, const bignum256 *prime) {
   // p->y = z^-1
   p->x = p->y;
-  bn_multiply(&p->x, &p->x, prime);
+  bn_square(&p->x, prime);
   // p->x = z^-2
   bn_multiply(&p->x, &p->y, prime);
   // p->y = z^-3
@@ -224,196 +236,349 @@ void jacobian_to_curve(const jacobian_curve_point *jp, curve_point *p,
   bn_mod(&p->y, prime);
 }
 
-void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2,
-                        const ecdsa_curve *curve) {
-  bignum256 r, h, r2;
-  bignum256 hcby, hsqx;
-  bignum256 xz, yz, az;
+void jacobian_to_curve(const jacobian_curve_point *jp, curve_point *p,
+                       const bignum256 *prime) {
+  p->y = jp->z;
+  bn_inverse(&p->y, prime);
+  jacobian_to_curve_zinv(jp, p, prime);
+}
+
+// convert n jacobian points to affine coordinates with a single
+// inversion (Montgomery's trick).  None of the points may be the
+// point at infinity.  The x coordinates of p are used as scratch
+// space for the running products of the z coordinates.
+void jacobian_to_curve_batch(const jacobian_curve_point *jp, curve_point *p,
+                             size_t n, const bignum256 *prime) {
+  size_t i;
+  bignum256 inv;
+  if (n == 0) return;
+
+  // p[i].x = z[0] * ... * z[i]
+  p[0].x = jp[0].z;
+  for (i = 1; i < n; i++) {
+    p[i].x = p[i - 1].x;
+    bn_multiply(&jp[i].z, &p[i].x, prime);
+  }
+  inv = p[n - 1].x;
+  bn_inverse(&inv, prime);
+  for (i = n - 1; i > 0; i--) {
+    // invariant: inv = (z[0] * ... * z[i])^-1
+    // p[i].y = z[i]^-1
+    p[i].y = p[i - 1].x;
+    bn_multiply(&inv, &p[i].y, prime);
+    // inv = (z[0] * ... * z[i-1])^-1
+    bn_multiply(&jp[i].z, &inv, prime);
+    jacobian_to_curve_zinv(&jp[i], &p[i], prime);
+  }
+  p[0].y = inv;
+  jacobian_to_curve_zinv(&jp[0], &p[0], prime);
+  memzero(&inv, sizeof(inv));
+}
+
+// generic point formulas, prime and a are read from the curve.
+#define JACOBIAN_FN(name) name
+#define JACOBIAN_STORAGE
+#define JACOBIAN_CURVE_A (curve->a)
+#define JACOBIAN_MULTIPLY(k, x) bn_multiply(k, x, prime)
+#define JACOBIAN_SQUARE(x) bn_square(x, prime)
+#include "ecdsa_jacobian.h"
+
+// point formulas specialized for secp256k1 (a = 0).
+#define JACOBIAN_FN(name) name##_secp256k1
+#define JACOBIAN_STORAGE static
+#define JACOBIAN_CURVE_A 0
+#define JACOBIAN_MULTIPLY(k, x) bn_multiply_secp256k1(k, x)
+#define JACOBIAN_SQUARE(x) bn_square_secp256k1(x)
+#include "ecdsa_jacobian.h"
+
+// the point formulas of a curve, chosen once per scalar multiplication.
+typedef struct {
+  void (*add)(const curve_point *p1, jacobian_curve_point *p2,
+              const ecdsa_curve *curve);
+  void (*madd)(const curve_point *p1, jacobian_curve_point *p2,
+               const ecdsa_curve *curve);
+  void (*dbl)(jacobian_curve_point *p, const ecdsa_curve *curve);
+  void (*add_coz)(jacobian_curve_point *p1, jacobian_curve_point *p2,
+                  const ecdsa_curve *curve);
+  int (*add_jacobian)(const jacobian_curve_point *p1,
+                      jacobian_curve_point *p2, const ecdsa_curve *curve);
+} jacobian_formulas;
+
+static void jacobian_formulas_select(const ecdsa_curve *curve,
+                                     jacobian_formulas *f) {
+  if (curve->a == 0 && bn_is_secp256k1_prime(&curve->prime)) {
+    f->add = point_jacobian_add_secp256k1;
+    f->madd = point_jacobian_madd_secp256k1;
+    f->dbl = point_jacobian_double_secp256k1;
+    f->add_coz = point_jacobian_add_coz_secp256k1;
+    f->add_jacobian = point_jacobian_add_jacobian_secp256k1;
+  } else {
+    f->add = point_jacobian_add;
+    f->madd = point_jacobian_madd;
+    f->dbl = point_jacobian_double;
+    f->add_coz = point_jacobian_add_coz;
+    f->add_jacobian = point_jacobian_add_jacobian;
+  }
+}
+
+#if USE_BN_X4
+
+// four lane version of point_jacobian_add for curves with a == 0.
+// p2[j] = p1[j] + p2[j] independently for every lane j.
+void point_jacobian_add_x4(const curve_point_x4 *p1,
+                           jacobian_curve_point_x4 *p2,
+                           const ecdsa_curve *curve) {
+  bignum256x4 r, h, r2;
+  bignum256x4 hcby, hsqx;
+  bignum256x4 xz, yz;
   int is_doubling;
   const bignum256 *prime = &curve->prime;
-  int a = curve->a;
-
-  assert(-3 <= a && a <= 0);
-
-  /* First we bring p1 to the same denominator:
-   * x1' := x1 * z2^2
-   * y1' := y1 * z2^3
-   */
-  /*
-   * lambda  = ((y1' - y2)/z2^3) / ((x1' - x2)/z2^2)
-   *         = (y1' - y2) / (x1' - x2) z2
-   * x3/z3^2 = lambda^2 - (x1' + x2)/z2^2
-   * y3/z3^3 = 1/2 lambda * (2x3/z3^2 - (x1' + x2)/z2^2) + (y1'+y2)/z2^3
-   *
-   * For the special case x1=x2, y1=y2 (doubling) we have
-   * lambda = 3/2 ((x2/z2^2)^2 + a) / (y2/z2^3)
-   *        = 3/2 (x2^2 + a*z2^4) / y2*z2)
-   *
-   * to get rid of fraction we write lambda as
-   * lambda = r / (h*z2)
-   * with  r = is_doubling ? 3/2 x2^2 + az2^4 : (y1 - y2)
-   *       h = is_doubling ?      y1+y2       : (x1 - x2)
-   *
-   * With z3 = h*z2  (the denominator of lambda)
-   * we get x3 = lambda^2*z3^2 - (x1' + x2)/z2^2*z3^2
-   *           = r^2 - h^2 * (x1' + x2)
-   *    and y3 = 1/2 r * (2x3 - h^2*(x1' + x2)) + h^3*(y1' + y2)
-   */
-
-  /* h = x1 - x2
-   * r = y1 - y2
-   * x3 = r^2 - h^3 - 2*h^2*x2
-   * y3 = r*(h^2*x2 - x3) - h^3*y2
-   * z3 = h*z2
-   */
 
+  assert(curve->a == 0);
+
+  // see point_jacobian_add for the formulas.
   xz = p2->z;
-  bn_multiply(&xz, &xz, prime);  // xz = z2^2
+  bn_square_x4(&xz, prime);         // xz = z2^2
   yz = p2->z;
-  bn_multiply(&xz, &yz, prime);  // yz = z2^3
+  bn_multiply_x4(&xz, &yz, prime);  // yz = z2^3
 
-  if (a != 0) {
-    az = xz;
-    bn_multiply(&az, &az, prime);  // az = z2^4
-    bn_mult_k(&az, -a, prime);     // az = -az2^4
-  }
-
-  bn_multiply(&p1->x, &xz, prime);  // xz = x1' = x1*z2^2;
-  h = xz;
-  bn_subtractmod(&h, &p2->x, &h, prime);
-  bn_fast_mod(&h, prime);
+  bn_multiply_x4(&p1->x, &xz, prime);  // xz = x1' = x1*z2^2;
+  bn_subtractmod_x4(&xz, &p2->x, &h, prime);
+  bn_fast_mod_x4(&h, prime);
   // h = x1' - x2;
 
-  bn_add(&xz, &p2->x);
+  bn_add_x4(&xz, &p2->x);
   // xz = x1' + x2
 
-  // check for h == 0 % prime.  Note that h never normalizes to
-  // zero, since h = x1' + 2*prime - x2 > 0 and a positive
-  // multiple of prime is always normalized to prime by
-  // bn_fast_mod.
-  is_doubling = bn_is_equal(&h, prime);
+  is_doubling = bn_is_equal_x4(&h, prime);
 
-  bn_multiply(&p1->y, &yz, prime);  // yz = y1' = y1*z2^3;
-  bn_subtractmod(&yz, &p2->y, &r, prime);
+  bn_multiply_x4(&p1->y, &yz, prime);  // yz = y1' = y1*z2^3;
+  bn_subtractmod_x4(&yz, &p2->y, &r, prime);
   // r = y1' - y2;
 
-  bn_add(&yz, &p2->y);
+  bn_add_x4(&yz, &p2->y);
   // yz = y1' + y2
 
   r2 = p2->x;
-  bn_multiply(&r2, &r2, prime);
-  bn_mult_k(&r2, 3, prime);
+  bn_square_x4(&r2, prime);
+  bn_mult_k_x4(&r2, 3, prime);
 
-  if (a != 0) {
-    // subtract -a z2^4, i.e, add a z2^4
-    bn_subtractmod(&r2, &az, &r2, prime);
-  }
-  bn_cmov(&r, is_doubling, &r2, &r);
-  bn_cmov(&h, is_doubling, &yz, &h);
+  bn_cmov_x4(&r, is_doubling, &r2, &r);
+  bn_cmov_x4(&h, is_doubling, &yz, &h);
 
   // hsqx = h^2
   hsqx = h;
-  bn_multiply(&hsqx, &hsqx, prime);
+  bn_square_x4(&hsqx, prime);
 
   // hcby = h^3
   hcby = h;
-  bn_multiply(&hsqx, &hcby, prime);
+  bn_multiply_x4(&hsqx, &hcby, prime);
 
   // hsqx = h^2 * (x1 + x2)
-  bn_multiply(&xz, &hsqx, prime);
+  bn_multiply_x4(&xz, &hsqx, prime);
 
   // hcby = h^3 * (y1 + y2)
-  bn_multiply(&yz, &hcby, prime);
+  bn_multiply_x4(&yz, &hcby, prime);
 
   // z3 = h*z2
-  bn_multiply(&h, &p2->z, prime);
+  bn_multiply_x4(&h, &p2->z, prime);
 
   // x3 = r^2 - h^2 (x1 + x2)
   p2->x = r;
-  bn_multiply(&p2->x, &p2->x, prime);
-  bn_subtractmod(&p2->x, &hsqx, &p2->x, prime);
-  bn_fast_mod(&p2->x, prime);
+  bn_square_x4(&p2->x, prime);
+  bn_subtractmod_x4(&p2->x, &hsqx, &p2->x, prime);
+  bn_fast_mod_x4(&p2->x, prime);
 
   // y3 = 1/2 (r*(h^2 (x1 + x2) - 2x3) - h^3 (y1 + y2))
-  bn_subtractmod(&hsqx, &p2->x, &p2->y, prime);
-  bn_subtractmod(&p2->y, &p2->x, &p2->y, prime);
-  bn_multiply(&r, &p2->y, prime);
-  bn_subtractmod(&p2->y, &hcby, &p2->y, prime);
-  bn_mult_half(&p2->y, prime);
-  bn_fast_mod(&p2->y, prime);
+  bn_subtractmod_x4(&hsqx, &p2->x, &p2->y, prime);
+  bn_subtractmod_x4(&p2->y, &p2->x, &p2->y, prime);
+  bn_multiply_x4(&r, &p2->y, prime);
+  bn_subtractmod_x4(&p2->y, &hcby, &p2->y, prime);
+  bn_mult_half_x4(&p2->y, prime);
+  bn_fast_mod_x4(&p2->y, prime);
 }
 
-void point_jacobian_double(jacobian_curve_point *p, const ecdsa_curve *curve) {
-  bignum256 az4, m, msq, ysq, xysq;
+#endif
+
+// pmult[j] = (2*j+1) * p for j = 0..7, the table of point_multiply.
+// 2*p and the odd multiples are computed with co-Z additions in
+// jacobian coordinates and converted to affine coordinates with a
+// single inversion.
+static void point_multiply_table(const ecdsa_curve *curve,
+                                 const jacobian_formulas *f,
+                                 const curve_point *p, curve_point *pmult) {
+  jacobian_curve_point jtwice;
+  jacobian_curve_point jpmult[8];
   const bignum256 *prime = &curve->prime;
+  int i;
+
+  // jtwice = 2*p and jpmult[0] = p over the same z
+  jtwice.x = p->x;
+  jtwice.y = p->y;
+  bn_one(&jtwice.z);
+  f->dbl(&jtwice, curve);
+  jpmult[0].z = jtwice.z;
+  curve_to_jacobian_z(p, &jpmult[0], prime);
+  // compute 3*p, etc by repeatedly adding 2*p with co-Z additions,
+  // which keep jtwice on the z of the last sum.
+  for (i = 1; i < 8; i++) {
+    jpmult[i] = jpmult[i - 1];
+    f->add_coz(&jtwice, &jpmult[i], curve);
+  }
+  jacobian_to_curve_batch(jpmult, pmult, 8, prime);
+  memzero(&jtwice, sizeof(jtwice));
+  memzero(jpmult, sizeof(jpmult));
+}
 
-  assert(-3 <= curve->a && curve->a <= 0);
-  /* usual algorithm:
-   *
-   * lambda  = (3((x/z^2)^2 + a) / 2y/z^3) = (3x^2 + az^4)/2yz
-   * x3/z3^2 = lambda^2 - 2x/z^2
-   * y3/z3^3 = lambda * (x/z^2 - x3/z3^2) - y/z^3
-   *
-   * to get rid of fraction we set
-   *  m = (3 x^2 + az^4) / 2
-   * Hence,
-   *  lambda = m / yz = m / z3
-   *
-   * With z3 = yz  (the denominator of lambda)
-   * we get x3 = lambda^2*z3^2 - 2*x/z^2*z3^2
-   *           = m^2 - 2*xy^2
-   *    and y3 = (lambda * (x/z^2 - x3/z3^2) - y/z^3) * z3^3
-   *           = m * (xy^2 - x3) - y^4
-   */
-
-  /* m = (3*x^2 + a z^4) / 2
-   * x3 = m^2 - 2*xy^2
-   * y3 = m*(xy^2 - x3) - 8y^4
-   * z3 = y*z
-   */
-
-  m = p->x;
-  bn_multiply(&m, &m, prime);
-  bn_mult_k(&m, 3, prime);
-
-  az4 = p->z;
-  bn_multiply(&az4, &az4, prime);
-  bn_multiply(&az4, &az4, prime);
-  bn_mult_k(&az4, -curve->a, prime);
-  bn_subtractmod(&m, &az4, &m, prime);
-  bn_mult_half(&m, prime);
-
-  // msq = m^2
-  msq = m;
-  bn_multiply(&msq, &msq, prime);
-  // ysq = y^2
-  ysq = p->y;
-  bn_multiply(&ysq, &ysq, prime);
-  // xysq = xy^2
-  xysq = p->x;
-  bn_multiply(&ysq, &xysq, prime);
-
-  // z3 = yz
-  bn_multiply(&p->y, &p->z, prime);
-
-  // x3 = m^2 - 2*xy^2
-  p->x = xysq;
-  bn_lshift(&p->x);
-  bn_fast_mod(&p->x, prime);
-  bn_subtractmod(&msq, &p->x, &p->x, prime);
-  bn_fast_mod(&p->x, prime);
-
-  // y3 = m*(xy^2 - x3) - y^4
-  bn_subtractmod(&xysq, &p->x, &p->y, prime);
-  bn_multiply(&m, &p->y, prime);
-  bn_multiply(&ysq, &ysq, prime);
-  bn_subtractmod(&p->y, &ysq, &p->y, prime);
-  bn_fast_mod(&p->y, prime);
+#if USE_SECP256K1_GLV
+
+// beta, the cube root of unity modulo p with
+// lambda * (x, y) = (beta * x, y), see scalar_split_lambda.
+static const bignum256 secp256k1_beta = {
+    {0x319501ee, 0x04e5b0a1, 0x2f58995c, 0x3c125d44, 0x3434e99c, 0x111e7ab0,
+     0x007106e6, 0x1a8ad95f, 0x00007ae9}};
+
+// returns the five bits 4*i .. 4*i+4 of a.  i is public, so the limb
+// access leaks nothing.
+static inline uint32_t point_multiply_window(const bignum256 *a, int i) {
+  const int j = (4 * i) / 30;
+  const int shift = (4 * i) % 30;
+  uint32_t bits = a->val[j] >> shift;
+  if (shift > 25) {
+    bits |= a->val[j + 1] << (30 - shift);
+  }
+  return bits & 31;
 }
 
-// res = k * p
-void point_multiply(const ecdsa_curve *curve, const bignum256 *k,
-                    const curve_point *p, curve_point *res) {
+// recodes a half r of scalar_split_lambda for point_multiply_glv:
+// a = |r| + 2^128, made odd by adding 1 if |r| is even.  Sets *is_even
+// to whether 1 was added and returns whether r is negative.
+static int point_multiply_glv_recode(const bignum256 *r, bignum256 *a,
+                                     int *is_even) {
+  bignum256 neg;
+  int is_negative = bn_is_less(&secp256k1.order_half, r);
+
+  scalar_negate(&neg, r);
+  bn_cmov(a, is_negative, &neg, r);
+  *is_even = (a->val[0] & 1) ^ 1;
+  bn_addi(a, *is_even);
+  // a < 2^128, add 2^128
+  assert(a->val[4] < (1u << 8) &&
+         (a->val[5] | a->val[6] | a->val[7] | a->val[8]) == 0);
+  a->val[4] += 1u << 8;
+  memzero(&neg, sizeof(neg));
+  return is_negative;
+}
+
+// adds the digit encoded in bits (see point_multiply) times its point in
+// pmult to jres.  jres holds its value negated if sign is set, the new
+// sign is returned.
+static inline uint32_t point_multiply_add_digit(const ecdsa_curve *curve,
+                                                const jacobian_formulas *f,
+                                                const curve_point *pmult,
+                                                uint32_t bits, uint32_t sign,
+                                                jacobian_curve_point *jres) {
+  uint32_t nsign = (bits >> 4) - 1;
+  bits ^= nsign;
+  bits &= 15;
+  // negate jres to make its sign equal to the sign of the digit.
+  conditional_negate(sign ^ nsign, &jres->z, &curve->prime);
+  f->add(&pmult[bits >> 1], jres, curve);
+  return nsign;
+}
+
+// jres = k * p for secp256k1 and 0 < k < n with the GLV method.
+// k is split into k = k1 + k2 * lambda with halves of at most 128 bits,
+// so that k * p = k1 * p + k2 * (lambda * p) needs only half of the
+// doublings.  Both halves use signed odd 4 bit digits as in
+// point_multiply, one joint window adds a digit of each half.
+static void point_multiply_glv(const ecdsa_curve *curve, const bignum256 *k,
+                               const curve_point *p,
+                               jacobian_curve_point *jres) {
+  int i, j;
+  bignum256 k1, k2, a1, a2;
+  int is_negative1, is_negative2, is_even1, is_even2;
+  uint32_t bits, sign;
+  jacobian_curve_point jtmp;
+  curve_point pmult1[8], pmult2[8], q;
+  const bignum256 *prime = &curve->prime;
+  jacobian_formulas f;
+
+  scalar_split_lambda(&k1, &k2, k);
+  is_negative1 = point_multiply_glv_recode(&k1, &a1, &is_even1);
+  is_negative2 = point_multiply_glv_recode(&k2, &a2, &is_even2);
+
+  // Now a1 = |k1| + 2^128 and a2 = |k2| + 2^128, both odd, recoded as
+  // a = sum_{i=0..32} a[i] 16^i with odd digits and a[32] = 1.  With
+  // p1 = +-p and p2 = +-lambda*p, the signs taken from k1 and k2,
+  //   k * p = sum_{i=0..31} 16^i (a1[i] * p1 + a2[i] * p2)
+  //           - is_even1 * p1 - is_even2 * p2.
+  // pmult1[j] = (2*j+1) * p1 and pmult2[j] = (2*j+1) * p2.
+  jacobian_formulas_select(curve, &f);
+  point_multiply_table(curve, &f, p, pmult1);
+  for (j = 0; j < 8; j++) {
+    pmult2[j] = pmult1[j];
+    bn_multiply(&secp256k1_beta, &pmult2[j].x, prime);
+    conditional_negate(-(uint32_t)is_negative1, &pmult1[j].y, prime);
+    conditional_negate(-(uint32_t)is_negative2, &pmult2[j].y, prime);
+  }
+
+  // initialize jres = a1[31] * p1 + a2[31] * p2 with its sign, then
+  // sum up the lower windows as in point_multiply.
+  bits = point_multiply_window(&a1, 31);
+  sign = (bits >> 4) - 1;
+  bits ^= sign;
+  bits &= 15;
+  curve_to_jacobian(&pmult1[bits >> 1], jres, prime);
+  sign = point_multiply_add_digit(curve, &f, pmult2,
+                                  point_multiply_window(&a2, 31), sign, jres);
+  for (i = 30; i >= 0; i--) {
+    f.dbl(jres, curve);
+    f.dbl(jres, curve);
+    f.dbl(jres, curve);
+    f.dbl(jres, curve);
+    sign = point_multiply_add_digit(
+        curve, &f, pmult1, point_multiply_window(&a1, i), sign, jres);
+    sign = point_multiply_add_digit(
+        curve, &f, pmult2, point_multiply_window(&a2, i), sign, jres);
+  }
+  conditional_negate(sign, &jres->z, prime);
+
+  // subtract the 1 added to even halves, p2 first.  jres - p2 would
+  // only be infinity for k = -+1, but then k1 = +-1 is odd.
+  q = pmult2[0];
+  conditional_negate(0xffffffff, &q.y, prime);
+  jtmp = *jres;
+  f.add(&q, &jtmp, curve);
+  bn_cmov(&jres->x, is_even2, &jtmp.x, &jres->x);
+  bn_cmov(&jres->y, is_even2, &jtmp.y, &jres->y);
+  bn_cmov(&jres->z, is_even2, &jtmp.z, &jres->z);
+  q = pmult1[0];
+  conditional_negate(0xffffffff, &q.y, prime);
+  jtmp = *jres;
+  f.add(&q, &jtmp, curve);
+  bn_cmov(&jres->x, is_even1, &jtmp.x, &jres->x);
+  bn_cmov(&jres->y, is_even1, &jtmp.y, &jres->y);
+  bn_cmov(&jres->z, is_even1, &jtmp.z, &jres->z);
+
+  memzero(&k1, sizeof(k1));
+  memzero(&k2, sizeof(k2));
+  memzero(&a1, sizeof(a1));
+  memzero(&a2, sizeof(a2));
+  memzero(&jtmp, sizeof(jtmp));
+  memzero(pmult1, sizeof(pmult1));
+  memzero(pmult2, sizeof(pmult2));
+  memzero(&q, sizeof(q));
+}
+
+#endif
+
+// jres = k * p in jacobian coordinates
+// returns 0 (and leaves jres untouched) iff k is zero, i.e., the result
+// is the point at infinity.
+static int point_multiply_jacobian(const ecdsa_curve *curve,
+                                   const bignum256 *k, const curve_point *p,
+                                   jacobian_curve_point *jres) {
   // this algorithm is loosely based on
   //  Katsuyuki Okeya and Tsuyoshi Takagi, The Width-w NAF Method Provides
   //  Small Memory and Fast Elliptic Scalar Multiplications Secure against
@@ -421,15 +586,15 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k,
   assert(bn_is_less(k, &curve->order));
 
   int i, j;
-  static CONFIDENTIAL bignum256 a;
+  bignum256 a;
   uint32_t *aptr;
   uint32_t abits;
   int ashift;
   uint32_t is_even = (k->val[0] & 1) - 1;
   uint32_t bits, sign, nsign;
-  static CONFIDENTIAL jacobian_curve_point jres;
   curve_point pmult[8];
   const bignum256 *prime = &curve->prime;
+  jacobian_formulas f;
 
   // is_even = 0xffffffff if k is even, 0 otherwise.
 
@@ -449,10 +614,17 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k,
 
   // special case 0*p:  just return zero. We don't care about constant time.
   if (!is_non_zero) {
-    point_set_infinity(res);
-    return;
+    return 0;
   }
 
+#if USE_SECP256K1_GLV
+  if (curve == &secp256k1) {
+    memzero(&a, sizeof(a));
+    point_multiply_glv(curve, k, p, jres);
+    return 1;
+  }
+#endif
+
   // Now a = k + 2^256 (mod curve->order) and a is odd.
   //
   // The idea is to bring the new a into the form.
@@ -467,15 +639,8 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k,
   // We compute |a[i]| * p in advance for all possible
   // values of |a[i]| * p.  pmult[i] = (2*i+1) * p
   // We compute p, 3*p, ..., 15*p and store it in the table pmult.
-  // store p^2 temporarily in pmult[7]
-  pmult[7] = *p;
-  point_double(curve, &pmult[7]);
-  // compute 3*p, etc by repeatedly adding p^2.
-  pmult[0] = *p;
-  for (i = 1; i < 8; i++) {
-    pmult[i] = pmult[7];
-    point_add(curve, &pmult[i - 1], &pmult[i]);
-  }
+  jacobian_formulas_select(curve, &f);
+  point_multiply_table(curve, &f, p, pmult);
 
   // now compute  res = sum_{i=0..63} a[i] * 16^i * p step by step,
   // starting with i = 63.
@@ -491,16 +656,16 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k,
   sign = (bits >> 4) - 1;
   bits ^= sign;
   bits &= 15;
-  curve_to_jacobian(&pmult[bits >> 1], &jres, prime);
+  curve_to_jacobian(&pmult[bits >> 1], jres, prime);
   for (i = 62; i >= 0; i--) {
     // sign = sign(a[i+1])  (0xffffffff for negative, 0 for positive)
     // invariant jres = (-1)^sign sum_{j=i+1..63} (a[j] * 16^{j-i-1} * p)
     // abits >> (ashift - 4) = lowbits(a >> (i*4))
 
-    point_jacobian_double(&jres, curve);
-    point_jacobian_double(&jres, curve);
-    point_jacobian_double(&jres, curve);
-    point_jacobian_double(&jres, curve);
+    f.dbl(jres, curve);
+    f.dbl(jres, curve);
+    f.dbl(jres, curve);
+    f.dbl(jres, curve);
 
     // get lowest 5 bits of a >> (i*4).
     ashift -= 4;
@@ -521,106 +686,693 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k,
 
     // negate last result to make signs of this round and the
     // last round equal.
-    conditional_negate(sign ^ nsign, &jres.z, prime);
+    conditional_negate(sign ^ nsign, &jres->z, prime);
 
     // add odd factor
-    point_jacobian_add(&pmult[bits >> 1], &jres, curve);
+    f.add(&pmult[bits >> 1], jres, curve);
     sign = nsign;
   }
-  conditional_negate(sign, &jres.z, prime);
-  jacobian_to_curve(&jres, res, prime);
+  conditional_negate(sign, &jres->z, prime);
   memzero(&a, sizeof(a));
+  memzero(pmult, sizeof(pmult));
+  return 1;
+}
+
+// res = k * p
+void point_multiply(const ecdsa_curve *curve, const bignum256 *k,
+                    const curve_point *p, curve_point *res) {
+  jacobian_curve_point jres;
+
+  if (point_multiply_jacobian(curve, k, p, &jres)) {
+    jacobian_to_curve(&jres, res, &curve->prime);
+  } else {
+    point_set_infinity(res);
+  }
   memzero(&jres, sizeof(jres));
 }
 
 #if USE_PRECOMPUTED_CP
 
-// res = k * G
-// k must be a normalized number with 0 <= k < curve->order
-void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k,
-                     curve_point *res) {
-  assert(bn_is_less(k, &curve->order));
+// a fixed-base comb table for window width w with rows rows,
+// cp[i * 2^(w-1) + j] = (2*j+1) * 2^(w*i) * G.
+// prefetch is set for the runtime table, whose lookups miss the cache.
+typedef struct {
+  const curve_point *cp;
+  int window, rows;
+  int prefetch;
+} comb_table;
+
+#if USE_RUNTIME_CP
+
+#define RUNTIME_CP_ROWS ((256 + RUNTIME_CP_WINDOW - 1) / RUNTIME_CP_WINDOW)
+#define RUNTIME_CP_POINTS (1 << (RUNTIME_CP_WINDOW - 1))
+// number of points converted to affine coordinates with one inversion
+#define RUNTIME_CP_CHUNK 1024
+
+// the runtime table, either built on the heap or mapped from a file.
+// runtime_cp.cp is NULL if there is none.
+static comb_table runtime_cp;
+static pthread_once_t runtime_cp_once = PTHREAD_ONCE_INIT;
+// the madvise result of runtime_cp_advise, see
+// scalar_multiply_runtime_hugepages
+static int runtime_cp_hugepages;
+
+// advise the kernel to back the table with transparent hugepages, which
+// saves most TLB misses of the random table lookups.  The advice is only
+// a hint: the kernel may refuse it (EINVAL without THP support) or accept
+// it and still use small pages, which is common for file mappings.
+static void runtime_cp_advise(void *table, size_t size) {
+#if USE_RUNTIME_CP_HUGEPAGES && defined(MADV_HUGEPAGE)
+  runtime_cp_hugepages = madvise(table, size, MADV_HUGEPAGE) == 0;
+#else
+  (void)table;
+  (void)size;
+  runtime_cp_hugepages = 0;
+#endif
+}
 
+typedef struct {
+  curve_point base;  // 2^(w*i) * G
+  curve_point *row;  // runtime_cp.cp + i * RUNTIME_CP_POINTS
+  int ok;
+} runtime_cp_job;
+
+// fills one row of the table: row[j] = (2*j+1) * base.
+// The points are public, so they are neither randomized nor erased.
+static void *runtime_cp_build_row(void *arg) {
+  runtime_cp_job *job = arg;
+  jacobian_curve_point *jp;
+  curve_point twice;
+  size_t i, j, m;
+
+  job->ok = 0;
+  jp = malloc(RUNTIME_CP_CHUNK * sizeof(jacobian_curve_point));
+  if (jp == NULL) return NULL;
+  twice = job->base;
+  point_double(&secp256k1, &twice);
+
+  jp[0].x = job->base.x;
+  jp[0].y = job->base.y;
+  bn_one(&jp[0].z);
+  for (i = 0; i < RUNTIME_CP_POINTS; i += m) {
+    m = RUNTIME_CP_POINTS - i;
+    if (m > RUNTIME_CP_CHUNK) m = RUNTIME_CP_CHUNK;
+    for (j = 1; j < m; j++) {
+      jp[j] = jp[j - 1];
+      point_jacobian_add_secp256k1(&twice, &jp[j], &secp256k1);
+    }
+    jacobian_to_curve_batch(jp, job->row + i, m, &secp256k1.prime);
+    // continue the next chunk from the last affine point
+    jp[0].x = job->row[i + m - 1].x;
+    jp[0].y = job->row[i + m - 1].y;
+    bn_one(&jp[0].z);
+    point_jacobian_add_secp256k1(&twice, &jp[0], &secp256k1);
+  }
+  free(jp);
+  job->ok = 1;
+  return NULL;
+}
+
+// builds the runtime table with one thread per row, unless a table
+// file was loaded before.  Leaves runtime_cp.cp NULL if the memory is
+// not available.
+static void runtime_cp_build(void) {
+  runtime_cp_job jobs[RUNTIME_CP_ROWS];
+  pthread_t threads[RUNTIME_CP_ROWS];
+  int started[RUNTIME_CP_ROWS];
+  const size_t size = (size_t)RUNTIME_CP_ROWS * RUNTIME_CP_POINTS *
+                      sizeof(curve_point);
+  curve_point *table;
+  int i, j, ok = 1;
+
+  if (runtime_cp.cp != NULL) {
+    return;
+  }
+  // hugepage aligned, so that the whole table can be backed by them
+  if (posix_memalign((void **)&table, 1 << 21, size) != 0) {
+    return;
+  }
+  runtime_cp_advise(table, size);
+  jobs[0].base = secp256k1.G;
+  for (i = 0; i < RUNTIME_CP_ROWS; i++) {
+    if (i > 0) {
+      jobs[i].base = jobs[i - 1].base;
+      for (j = 0; j < RUNTIME_CP_WINDOW; j++) {
+        point_double(&secp256k1, &jobs[i].base);
+      }
+    }
+    jobs[i].row = table + (size_t)i * RUNTIME_CP_POINTS;
+    started[i] =
+        pthread_create(&threads[i], NULL, runtime_cp_build_row, &jobs[i]) == 0;
+    if (!started[i]) {
+      // no more threads, build the row here
+      runtime_cp_build_row(&jobs[i]);
+    }
+  }
+  for (i = 0; i < RUNTIME_CP_ROWS; i++) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+    ok &= jobs[i].ok;
+  }
+  if (!ok) {
+    free(table);
+    return;
+  }
+  runtime_cp.cp = table;
+  runtime_cp.window = RUNTIME_CP_WINDOW;
+  runtime_cp.rows = RUNTIME_CP_ROWS;
+  runtime_cp.prefetch = 1;
+}
+
+int scalar_multiply_runtime_init(void) {
+  pthread_once(&runtime_cp_once, runtime_cp_build);
+  return runtime_cp.cp != NULL;
+}
+
+// header of a table file written by tools/mkcpfile.py.  The points
+// follow at offset RUNTIME_CP_FILE_OFFSET.
+typedef struct {
+  char magic[8];        // "CPTABLE\0"
+  uint32_t version;     // RUNTIME_CP_FILE_VERSION
+  uint32_t window;      // window width w
+  uint32_t rows;        // ceil(256 / w)
+  uint32_t points;      // 2^(w-1) points per row
+  uint32_t point_size;  // sizeof(curve_point)
+  uint32_t byte_order;  // 0x01020304 in the byte order of the writer
+  uint8_t sha256[SHA256_DIGEST_LENGTH];  // of the points
+} runtime_cp_file_header;
+
+#define RUNTIME_CP_FILE_VERSION 1
+#define RUNTIME_CP_FILE_OFFSET 4096
+
+// sha256 of the points of the table file for the window widths w = 2..16.
+// The tables are deterministic, so a file that hashes to anything else
+// is stale, corrupted or forged, whatever its header says.
+static const uint8_t runtime_cp_file_sha256[15][SHA256_DIGEST_LENGTH] = {
+    // w = 2
+    {0x7e, 0x07, 0xef, 0x37, 0x0d, 0x35, 0xc1, 0x2b, 0xe5, 0x4e, 0xeb,
+     0xa4, 0x5c, 0x9a, 0xb4, 0xc8, 0x9a, 0xc9, 0xee, 0x72, 0xc6, 0xa2,
+     0xa3, 0x67, 0xdd, 0x3a, 0x09, 0x30, 0x64, 0x96, 0xf3, 0x88},
+    // w = 3
+    {0x84, 0xf5, 0x8e, 0x62, 0x87, 0xbd, 0xb7, 0x9c, 0x6b, 0x30, 0xa3,
+     0x5e, 0xf2, 0xfe, 0x4f, 0x49, 0xe1, 0xf0, 0x14, 0x82, 0x6c, 0x58,
+     0xa6, 0xf6, 0xbe, 0x16, 0xc0, 0x4f, 0xd8, 0x8c, 0x24, 0xec},
+    // w = 4
+    {0xa8, 0xdd, 0xc4, 0x81, 0x0e, 0x22, 0xf7, 0xb9, 0xa6, 0x4c, 0xb7,
+     0xbc, 0xd1, 0xba, 0x59, 0x2e, 0x85, 0x2b, 0x15, 0x44, 0xef, 0xd2,
+     0x04, 0x90, 0x9a, 0x83, 0x13, 0x4d, 0xdb, 0xd7, 0xb9, 0xfb},
+    // w = 5
+    {0x22, 0x98, 0xfe, 0xe5, 0xa8, 0xa6, 0x4b, 0x9f, 0x87, 0xea, 0x53,
+     0x3c, 0x92, 0x1c, 0x75, 0x31, 0x4c, 0x39, 0x9e, 0xc7, 0xdc, 0x95,
+     0x57, 0x38, 0x40, 0x33, 0x9b, 0x57, 0x7e, 0x39, 0x54, 0xbf},
+    // w = 6
+    {0x51, 0xff, 0x3c, 0xb8, 0xc6, 0xab, 0xc8, 0x7d, 0xaa, 0x49, 0xac,
+     0xd9, 0xef, 0x52, 0x5e, 0xe2, 0x19, 0x95, 0x29, 0x05, 0x66, 0xbd,
+     0x3b, 0xa2, 0xb6, 0xf3, 0xad, 0xe0, 0xd7, 0xa3, 0x59, 0xb8},
+    // w = 7
+    {0x16, 0xd7, 0x7a, 0x7c, 0x84, 0x6a, 0x9f, 0x27, 0x5f, 0x33, 0xeb,
+     0x95, 0x5d, 0xaa, 0x67, 0x64, 0x7f, 0x60, 0xe1, 0xbe, 0x42, 0x67,
+     0x22, 0x5b, 0xe6, 0xca, 0x7c, 0x53, 0xba, 0xaa, 0xea, 0x8d},
+    // w = 8
+    {0xe3, 0xd4, 0xa5, 0xe4, 0xed, 0x01, 0x5a, 0x49, 0x16, 0x30, 0xc7,
+     0x2d, 0x96, 0x51, 0x73, 0xdb, 0x2b, 0x6b, 0x8c, 0x3d, 0x1b, 0x95,
+     0xd3, 0x6d, 0x76, 0xea, 0x7e, 0x78, 0xdc, 0x97, 0x43, 0xaf},
+    // w = 9
+    {0x8f, 0xac, 0x56, 0x4e, 0x15, 0xc4, 0xf9, 0x76, 0xb0, 0xe4, 0x29,
+     0xe1, 0x7f, 0xa7, 0xd3, 0xa1, 0x8d, 0xb0, 0x82, 0x14, 0xf0, 0xcb,
+     0x29, 0x96, 0xf3, 0xdc, 0x73, 0x5f, 0xee, 0x73, 0x6f, 0x4d},
+    // w = 10
+    {0x33, 0x5c, 0x9e, 0x83, 0xc5, 0x16, 0x83, 0xb1, 0x40, 0x08, 0xf0,
+     0x9d, 0xfe, 0xfa, 0xe2, 0xe7, 0x65, 0xed, 0xcf, 0x82, 0xd0, 0xcd,
+     0x50, 0x0a, 0xbf, 0xbb, 0x74, 0xec, 0xbf, 0xd4, 0x09, 0x09},
+    // w = 11
+    {0x12, 0x22, 0x46, 0x96, 0x4b, 0x5c, 0xc6, 0xaf, 0x69, 0xa9, 0x41,
+     0x70, 0x32, 0x75, 0xd8, 0x0b, 0xa2, 0xe2, 0xa8, 0xd6, 0x06, 0x90,
+     0x0b, 0x91, 0x45, 0xd3, 0x3e, 0x75, 0xe3, 0x73, 0x51, 0xf4},
+    // w = 12
+    {0x91, 0xc6, 0x6b, 0x26, 0x16, 0xeb, 0x85, 0x0b, 0x19, 0x0c, 0xd2,
+     0xea, 0xc9, 0x4a, 0xb4, 0xd3, 0xc2, 0x6c, 0x28, 0x97, 0xf6, 0x55,
+     0x77, 0x64, 0x20, 0x83, 0x25, 0xb3, 0x33, 0xa6, 0x41, 0xa9},
+    // w = 13
+    {0xe1, 0x2e, 0x0a, 0xb8, 0x92, 0x96, 0x9f, 0xf7, 0x53, 0xb3, 0x8d,
+     0x7b, 0x24, 0x9a, 0x4f, 0x25, 0x08, 0xd5, 0xcd, 0x34, 0xdf, 0xc4,
+     0x21, 0x8e, 0x7e, 0xe9, 0x77, 0x24, 0x81, 0x69, 0xc4, 0x0b},
+    // w = 14
+    {0x7a, 0x7e, 0x09, 0xa2, 0xec, 0x75, 0x2f, 0x7f, 0x14, 0x7e, 0x6d,
+     0xd0, 0xb7, 0x81, 0xa8, 0x81, 0x36, 0x0c, 0xb7, 0x13, 0xe9, 0xb8,
+     0x50, 0x49, 0x81, 0x47, 0xa6, 0x1b, 0x5b, 0x61, 0x08, 0x88},
+    // w = 15
+    {0x4e, 0x7e, 0xaa, 0x73, 0xd9, 0x3c, 0xfc, 0x3b, 0x8f, 0x1b, 0x12,
+     0xb2, 0xbf, 0x48, 0xc4, 0xd3, 0x56, 0xf0, 0xa7, 0x8b, 0x53, 0xa1,
+     0x87, 0xaf, 0x5c, 0xff, 0x85, 0x66, 0x42, 0xa6, 0x61, 0x86},
+    // w = 16
+    {0xad, 0x59, 0xce, 0x97, 0xe8, 0x21, 0xa0, 0x82, 0x23, 0x19, 0x2f,
+     0x4c, 0x95, 0x2a, 0xf5, 0xd6, 0xba, 0xe4, 0xea, 0x7d, 0x5f, 0x28,
+     0x7d, 0x66, 0xd9, 0x53, 0x3b, 0xfd, 0x69, 0x6c, 0x21, 0x0b},
+};
+
+// checks that the first point of every row of a table is on the curve
+// and equal to 2^(w*i) * G, and that the last one is on the curve.
+// This catches a table built for another base point or window layout
+// before any key is derived from it.
+static int runtime_cp_check_rows(const curve_point *cp, int window,
+                                 int rows) {
+  curve_point base = secp256k1.G;
+  const curve_point *p;
+  size_t first;
   int i, j;
-  static CONFIDENTIAL bignum256 a;
+
+  for (i = 0; i < rows; i++) {
+    for (j = 0; i > 0 && j < window; j++) {
+      point_double(&secp256k1, &base);
+    }
+    first = (size_t)i << (window - 1);
+    p = &cp[first];
+    if (!ecdsa_validate_pubkey(&secp256k1, p) || !point_is_equal(p, &base)) {
+      return 0;
+    }
+    p = &cp[first + (1u << (window - 1)) - 1];
+    if (!ecdsa_validate_pubkey(&secp256k1, p)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// maps the table file at path, see scalar_multiply_runtime_load.  With
+// hash_points unset the points are trusted to match the header hash, see
+// scalar_multiply_runtime_load_checked.
+static int runtime_cp_load(const char *path, int hash_points) {
+  runtime_cp_file_header h;
+  struct stat st;
+  uint8_t hash[SHA256_DIGEST_LENGTH];
+  const uint8_t *map;
+  size_t size;
+  int fd, flags = MAP_SHARED;
+
+  if (runtime_cp.cp != NULL) {
+    return 0;
+  }
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  if (fstat(fd, &st) != 0 || read(fd, &h, sizeof(h)) != sizeof(h) ||
+      memcmp(h.magic, "CPTABLE", 8) != 0 ||
+      h.version != RUNTIME_CP_FILE_VERSION || h.byte_order != 0x01020304 ||
+      h.point_size != sizeof(curve_point) || h.window < 2 || h.window > 16 ||
+      h.rows != (256 + h.window - 1) / h.window ||
+      h.points != 1u << (h.window - 1)) {
+    close(fd);
+    return 0;
+  }
+  size = (size_t)h.rows * h.points * sizeof(curve_point);
+  if ((uint64_t)st.st_size != RUNTIME_CP_FILE_OFFSET + (uint64_t)size) {
+    close(fd);
+    return 0;
+  }
+#ifdef MAP_POPULATE
+  // fault in the whole table now instead of during the lookups
+  flags |= MAP_POPULATE;
+#endif
+  map = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return 0;
+  }
+  // the hash reads the whole file, which MAP_POPULATE faults in anyway.
+  // Without it only the header hash is compared with the pinned one.
+  if (hash_points) {
+    sha256_Raw(map + RUNTIME_CP_FILE_OFFSET, size, hash);
+  } else {
+    memcpy(hash, h.sha256, sizeof(hash));
+  }
+  if (memcmp(hash, runtime_cp_file_sha256[h.window - 2], sizeof(hash)) != 0 ||
+      memcmp(hash, h.sha256, sizeof(hash)) != 0 ||
+      !runtime_cp_check_rows(
+          (const curve_point *)(map + RUNTIME_CP_FILE_OFFSET), h.window,
+          h.rows)) {
+    munmap((void *)map, st.st_size);
+    return 0;
+  }
+  runtime_cp_advise((void *)map, st.st_size);
+  runtime_cp.cp = (const curve_point *)(map + RUNTIME_CP_FILE_OFFSET);
+  runtime_cp.window = h.window;
+  runtime_cp.rows = h.rows;
+  runtime_cp.prefetch = 1;
+  return 1;
+}
+
+int scalar_multiply_runtime_load(const char *path) {
+  return runtime_cp_load(path, 1);
+}
+
+int scalar_multiply_runtime_load_checked(const char *path) {
+  return runtime_cp_load(path, 0);
+}
+
+int scalar_multiply_runtime_hugepages(void) {
+  if (runtime_cp.cp == NULL) {
+    return -1;
+  }
+  return runtime_cp_hugepages;
+}
+
+#endif
+
+// selects the largest comb table available for curve
+static void comb_table_select(const ecdsa_curve *curve, comb_table *t) {
+#if USE_RUNTIME_CP
+  if (curve == &secp256k1 && scalar_multiply_runtime_init()) {
+    *t = runtime_cp;
+    return;
+  }
+#endif
+  t->cp = &curve->cp[0][0];
+  t->window = PRECOMPUTED_CP_WINDOW;
+  t->rows = PRECOMPUTED_CP_ROWS;
+  t->prefetch = 0;
+}
+
+// returns the lowest signed digit d of a for window width w, encoded
+// as |d| with the sign in bit 0, i.e., the table index |d| >> 1 and
+// (lowbits & 1) == 0 iff d < 0.  bits holds the lowest w + 1 bits of a.
+// d = a & (2^w - 1) if bit w of a is set and - (2^w - (a & (2^w - 1)))
+// otherwise.  Since a is odd, |d| can be computed as
+//   (a ^ (((a >> w) & 1) - 1)) & (2^w - 1)
+static inline uint32_t scalar_multiply_digit(uint32_t bits, int w) {
+  uint32_t lowbits = bits & ((2u << w) - 1);
+  lowbits ^= (lowbits >> w) - 1;
+  return lowbits & ((1u << w) - 1);
+}
+
+// returns the index of |d| * 2^(w*i) * G in the table for the digit d of
+// row i, encoded as lowbits returned by scalar_multiply_digit.
+static inline size_t comb_table_index(const comb_table *t, int i,
+                                      uint32_t lowbits) {
+  return ((size_t)i << (t->window - 1)) + (lowbits >> 1);
+}
+
+// returns the point |d| * 2^(w*i) * G in place, see comb_table_index.
+static inline const curve_point *comb_table_get(const comb_table *t, int i,
+                                                uint32_t lowbits) {
+  return &t->cp[comb_table_index(t, i, lowbits)];
+}
+
+// starts loading the entry of row i + 1 into the cache, so that it
+// arrives while the point of row i is added.  a is the scalar shifted
+// for row i, the next digit is in its bits w .. 2w.  A 72 byte point
+// spans two cache lines, both are prefetched.  Does nothing for
+// curve->cp, whose lookups stay as they were.
+static inline void comb_table_prefetch(const comb_table *t, int i,
+                                       const bignum256 *a) {
+#if USE_RUNTIME_CP
+  const curve_point *p;
+  if (!t->prefetch || i + 1 >= t->rows) return;
+  p = comb_table_get(
+      t, i + 1,
+      scalar_multiply_digit(
+          (a->val[0] >> t->window) | (a->val[1] << (30 - t->window)),
+          t->window));
+  __builtin_prefetch(p);
+  __builtin_prefetch((const uint8_t *)(p + 1) - 1);
+#else
+  (void)t;
+  (void)i;
+  (void)a;
+#endif
+}
+
+// a = a >> w
+static inline void bn_rshift_window(bignum256 *a, int w) {
+  int j;
+  for (j = 0; j < 8; j++) {
+    a->val[j] =
+        (a->val[j] >> w) | ((a->val[j + 1] & ((1u << w) - 1)) << (30 - w));
+  }
+  a->val[j] >>= w;
+}
+
+// a = k + 2^(w * rows) (mod curve->order) with a odd, the recoded form
+// of k used by the comb method below.
+// returns 0 iff k is zero.
+static uint32_t scalar_multiply_recode(const ecdsa_curve *curve,
+                                       const comb_table *t, const bignum256 *k,
+                                       bignum256 *a) {
+  int j;
   uint32_t is_even = (k->val[0] & 1) - 1;
-  uint32_t lowbits;
-  static CONFIDENTIAL jacobian_curve_point jres;
-  const bignum256 *prime = &curve->prime;
 
   // is_even = 0xffffffff if k is even, 0 otherwise.
 
-  // add 2^256.
+  // add 2^(w * rows), which is at least 2^256.
   // make number odd: subtract curve->order if even
   uint32_t tmp = 1;
   uint32_t is_non_zero = 0;
   for (j = 0; j < 8; j++) {
     is_non_zero |= k->val[j];
     tmp += 0x3fffffff + k->val[j] - (curve->order.val[j] & is_even);
-    a.val[j] = tmp & 0x3fffffff;
+    a->val[j] = tmp & 0x3fffffff;
     tmp >>= 30;
   }
   is_non_zero |= k->val[j];
-  a.val[j] = tmp + 0xffff + k->val[j] - (curve->order.val[j] & is_even);
-  assert((a.val[0] & 1) != 0);
+  a->val[j] = tmp + (1u << (t->window * t->rows - 240)) - 1 + k->val[j] -
+              (curve->order.val[j] & is_even);
+  assert((a->val[0] & 1) != 0);
+  return is_non_zero;
+}
+
+// jres = k * G in jacobian coordinates, or jres = jres + k * G if add
+// is set.
+// k must be a normalized number with 0 <= k < curve->order
+// returns 0 (and leaves jres untouched) iff k is zero.
+static int scalar_multiply_jacobian(const ecdsa_curve *curve,
+                                    const bignum256 *k,
+                                    jacobian_curve_point *jres, int add) {
+  assert(bn_is_less(k, &curve->order));
+
+  int i;
+  bignum256 a;
+  const curve_point *p;
+  uint32_t lowbits;
+  const bignum256 *prime = &curve->prime;
+  jacobian_formulas f;
+  comb_table t;
 
+  comb_table_select(curve, &t);
   // special case 0*G:  just return zero. We don't care about constant time.
-  if (!is_non_zero) {
-    point_set_infinity(res);
-    return;
+  if (!scalar_multiply_recode(curve, &t, k, &a)) {
+    return 0;
   }
 
-  // Now a = k + 2^256 (mod curve->order) and a is odd.
+  // Now a = k + 2^(w*N) (mod curve->order) and a is odd, where
+  // w = t.window and N = t.rows (w = 4 and N = 64 for the default
+  // table curve->cp).
   //
   // The idea is to bring the new a into the form.
-  // sum_{i=0..64} a[i] 16^i,  where |a[i]| < 16 and a[i] is odd.
+  // sum_{i=0..N} a[i] 2^(w*i),  where |a[i]| < 2^w and a[i] is odd.
   // a[0] is odd, since a is odd.  If a[i] would be even, we can
-  // add 1 to it and subtract 16 from a[i-1].  Afterwards,
-  // a[64] = 1, which is the 2^256 that we added before.
+  // add 1 to it and subtract 2^w from a[i-1].  Afterwards,
+  // a[N] = 1, which is the 2^(w*N) that we added before.
   //
-  // Since k = a - 2^256 (mod curve->order), we can compute
-  //   k*G = sum_{i=0..63} a[i] 16^i * G
+  // Since k = a - 2^(w*N) (mod curve->order), we can compute
+  //   k*G = sum_{i=0..N-1} a[i] 2^(w*i) * G
   //
-  // We have a big table curve->cp that stores all possible
-  // values of |a[i]| 16^i * G.
-  // curve->cp[i][j] = (2*j+1) * 16^i * G
+  // We have a big table t that stores all possible
+  // values of |a[i]| 2^(w*i) * G, see comb_table.
+
+  // now compute  res = sum_{i=0..N-1} a[i] * 2^(w*i) * G step by step.
+  // initial res = |a[0]| * G, see scalar_multiply_digit.
+  lowbits = scalar_multiply_digit(a.val[0], t.window);
+  p = comb_table_get(&t, 0, lowbits);
+  comb_table_prefetch(&t, 0, &a);
+  jacobian_formulas_select(curve, &f);
+  if (add) {
+    // res = sign(a[0]) jres + |a[0]| * G, so that jres keeps its sign
+    // relative to the sum.
+    conditional_negate((lowbits & 1) - 1, &jres->y, prime);
+    f.add(p, jres, curve);
+  } else {
+    curve_to_jacobian(p, jres, prime);
+  }
+  for (i = 1; i < t.rows; i++) {
+    // invariant res = sign(a[i-1]) sum_{j=0..i-1} (a[j] * 2^(w*j) * G)
 
-  // now compute  res = sum_{i=0..63} a[i] * 16^i * G step by step.
-  // initial res = |a[0]| * G.  Note that a[0] = a & 0xf if (a&0x10) != 0
-  // and - (16 - (a & 0xf)) otherwise.   We can compute this as
-  //   ((a ^ (((a >> 4) & 1) - 1)) & 0xf) >> 1
-  // since a is odd.
-  lowbits = a.val[0] & ((1 << 5) - 1);
-  lowbits ^= (lowbits >> 4) - 1;
-  lowbits &= 15;
-  curve_to_jacobian(&curve->cp[0][lowbits >> 1], &jres, prime);
-  for (i = 1; i < 64; i++) {
-    // invariant res = sign(a[i-1]) sum_{j=0..i-1} (a[j] * 16^j * G)
-
-    // shift a by 4 places.
-    for (j = 0; j < 8; j++) {
-      a.val[j] = (a.val[j] >> 4) | ((a.val[j + 1] & 0xf) << 26);
-    }
-    a.val[j] >>= 4;
-    // a = old(a)>>(4*i)
+    // shift a by w places.
+    bn_rshift_window(&a, t.window);
+    // a = old(a)>>(w*i)
     // a is even iff sign(a[i-1]) = -1
 
-    lowbits = a.val[0] & ((1 << 5) - 1);
-    lowbits ^= (lowbits >> 4) - 1;
-    lowbits &= 15;
+    lowbits = scalar_multiply_digit(a.val[0], t.window);
+    p = comb_table_get(&t, i, lowbits);
+    comb_table_prefetch(&t, i, &a);
     // negate last result to make signs of this round and the
     // last round equal.
-    conditional_negate((lowbits & 1) - 1, &jres.y, prime);
+    conditional_negate((lowbits & 1) - 1, &jres->y, prime);
+
+    // add odd factor.  Before row i, res = +-S * G with
+    // |S| < 2^(w*i) <= |a[i]| 2^(w*i) = T, and |S| + T < 2^(w*(i+1)) +
+    // 2^(w*i), which is below curve->order for i <= N-2.  So S != +-T
+    // modulo the order and the cheaper addition without the doubling
+    // case is safe.  The last row and an arbitrary jres (add) are not
+    // covered by this and take the full addition.
+    if (add || i == t.rows - 1) {
+      f.add(p, jres, curve);
+    } else {
+      f.madd(p, jres, curve);
+    }
+  }
+  conditional_negate(((a.val[0] >> t.window) & 1) - 1, &jres->y, prime);
+  memzero(&a, sizeof(a));
+  return 1;
+}
+
+#if USE_BN_X4
+
+// Negate a (modulo prime) in the lanes selected by cond.
+// The timing of this function does not depend on cond.
+static void conditional_negate_x4(int cond, bignum256x4 *a,
+                                  const bignum256 *prime) {
+  bignum256x4 zero, neg;
+  bn_zero_x4(&zero);
+  bn_subtractmod_x4(&zero, a, &neg, prime);
+  bn_cmov_x4(a, cond, &neg, a);
+}
+
+// jres[j] = k[j] * G  for the four lanes j = 0..3 computed in lockstep,
+// see scalar_multiply_jacobian.  The curve must have a == 0.
+// returns the mask of lanes with k[j] != 0, jres[j] is undefined for
+// the other lanes.
+int scalar_multiply_jacobian_x4(const ecdsa_curve *curve, const bignum256 *k,
+                                jacobian_curve_point *jres) {
+  int i, j, lanes = 0, negate;
+  bignum256 a[4];
+  uint32_t lowbits;
+  const curve_point *q;
+  curve_point_x4 p;
+  jacobian_curve_point_x4 jr;
+  const bignum256 *prime = &curve->prime;
+  comb_table t;
+
+  assert(curve->a == 0);
+  comb_table_select(curve, &t);
+  for (j = 0; j < 4; j++) {
+    assert(bn_is_less(&k[j], &curve->order));
+    if (scalar_multiply_recode(curve, &t, &k[j], &a[j])) {
+      lanes |= 1 << j;
+    }
+
+    lowbits = scalar_multiply_digit(a[j].val[0], t.window);
+    q = comb_table_get(&t, 0, lowbits);
+    comb_table_prefetch(&t, 0, &a[j]);
+    curve_to_jacobian(q, &jres[j], prime);
+    bn_x4_set_lane(&jr.x, j, &jres[j].x);
+    bn_x4_set_lane(&jr.y, j, &jres[j].y);
+    bn_x4_set_lane(&jr.z, j, &jres[j].z);
+  }
+  for (i = 1; i < t.rows; i++) {
+    negate = 0;
+    for (j = 0; j < 4; j++) {
+      // shift a by w places, see scalar_multiply_jacobian.
+      bn_rshift_window(&a[j], t.window);
+
+      lowbits = scalar_multiply_digit(a[j].val[0], t.window);
+      negate |= (~lowbits & 1) << j;
+      q = comb_table_get(&t, i, lowbits);
+      comb_table_prefetch(&t, i, &a[j]);
+      bn_x4_set_lane(&p.x, j, &q->x);
+      bn_x4_set_lane(&p.y, j, &q->y);
+    }
+    // negate last result to make signs of this round and the
+    // last round equal.
+    conditional_negate_x4(negate, &jr.y, prime);
 
     // add odd factor
-    point_jacobian_add(&curve->cp[i][lowbits >> 1], &jres, curve);
+    point_jacobian_add_x4(&p, &jr, curve);
   }
-  conditional_negate(((a.val[0] >> 4) & 1) - 1, &jres.y, prime);
-  jacobian_to_curve(&jres, res, prime);
-  memzero(&a, sizeof(a));
+  negate = 0;
+  for (j = 0; j < 4; j++) {
+    negate |= (~(a[j].val[0] >> t.window) & 1) << j;
+  }
+  conditional_negate_x4(negate, &jr.y, prime);
+  for (j = 0; j < 4; j++) {
+    bn_x4_get_lane(&jr.x, j, &jres[j].x);
+    bn_x4_get_lane(&jr.y, j, &jres[j].y);
+    bn_x4_get_lane(&jr.z, j, &jres[j].z);
+  }
+  memzero(a, sizeof(a));
+  memzero(&p, sizeof(p));
+  memzero(&jr, sizeof(jr));
+  return lanes;
+}
+
+#endif
+
+// res = k * G
+// k must be a normalized number with 0 <= k < curve->order
+void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k,
+                     curve_point *res) {
+  jacobian_curve_point jres;
+
+  if (!scalar_multiply_jacobian(curve, k, &jres, 0)) {
+    point_set_infinity(res);
+    return;
+  }
+  jacobian_to_curve(&jres, res, &curve->prime);
   memzero(&jres, sizeof(jres));
 }
 
+// res[i] = k[i] * G  for i = 0..n-1
+// every k[i] must be a normalized number with 0 <= k[i] < curve->order
+// The points are computed in chunks of SCALAR_MULTIPLY_BATCH_SIZE and
+// every chunk is converted to affine coordinates with one inversion.
+void scalar_multiply_batch(const ecdsa_curve *curve, const bignum256 *k,
+                           curve_point *res, size_t n) {
+  jacobian_curve_point jres[SCALAR_MULTIPLY_BATCH_SIZE];
+  size_t i, m;
+  uint32_t is_infinity;
+
+  while (n > 0) {
+    m = n < SCALAR_MULTIPLY_BATCH_SIZE ? n : SCALAR_MULTIPLY_BATCH_SIZE;
+    is_infinity = 0;
+    i = 0;
+#if USE_BN_X4
+    // four points at a time when the cpu has vector instructions
+    if (curve->a == 0 && bn_x4_is_accelerated(&curve->prime)) {
+      for (; i + 4 <= m; i += 4) {
+        is_infinity |=
+            (uint32_t)(~scalar_multiply_jacobian_x4(curve, &k[i], &jres[i]) &
+                       BN_X4_ALL_LANES)
+            << i;
+      }
+    }
+#endif
+    for (; i < m; i++) {
+      if (!scalar_multiply_jacobian(curve, &k[i], &jres[i], 0)) {
+        is_infinity |= 1u << i;
+      }
+    }
+    for (i = 0; i < m; i++) {
+      if (is_infinity & (1u << i)) {
+        // keep the batch inversion well defined, fixed up below
+        bn_one(&jres[i].x);
+        bn_one(&jres[i].y);
+        bn_one(&jres[i].z);
+      }
+    }
+    jacobian_to_curve_batch(jres, res, m, &curve->prime);
+    for (i = 0; i < m; i++) {
+      if (is_infinity & (1u << i)) {
+        point_set_infinity(&res[i]);
+      }
+    }
+    k += m;
+    res += m;
+    n -= m;
+  }
+  memzero(jres, sizeof(jres));
+}
+
 #else
 
 void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k,
@@ -628,8 +1380,293 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k,
   point_multiply(curve, k, &curve->G, res);
 }
 
+void scalar_multiply_batch(const ecdsa_curve *curve, const bignum256 *k,
+                           curve_point *res, size_t n) {
+  size_t i;
+  for (i = 0; i < n; i++) {
+    scalar_multiply(curve, &k[i], &res[i]);
+  }
+}
+
+#endif
+
+// res = k1 * G + k2 * p
+// k1 and k2 must be normalized numbers with 0 <= k < curve->order.
+// Both products are summed up in one jacobian point that is converted to
+// affine coordinates once.  The comb table adds k1 * G without any
+// doublings, so the doublings are only spent on k2 * p (half of them
+// with USE_SECP256K1_GLV).  Not constant time, this is meant for public
+// data such as signature verification.  If an intermediate sum hits
+// the point at infinity, the two products are computed separately and
+// added with point_add.
+void point_multiply_dual(const ecdsa_curve *curve, const bignum256 *k1,
+                         const bignum256 *k2, const curve_point *p,
+                         curve_point *res) {
+  jacobian_curve_point jres;
+  bignum256 z;
+  int is_non_zero;
+  const bignum256 *prime = &curve->prime;
+
+  is_non_zero = point_multiply_jacobian(curve, k2, p, &jres);
+#if USE_PRECOMPUTED_CP
+  is_non_zero |= scalar_multiply_jacobian(curve, k1, &jres, is_non_zero);
+#else
+  // without the comb table k1 * G costs a full point_multiply anyway.
+  if (!bn_is_zero(k1)) {
+    curve_point q;
+    jacobian_formulas f;
+    point_multiply(curve, k1, &curve->G, &q);
+    if (is_non_zero) {
+      jacobian_formulas_select(curve, &f);
+      f.add(&q, &jres, curve);
+    } else {
+      curve_to_jacobian(&q, &jres, prime);
+      is_non_zero = 1;
+    }
+  }
+#endif
+  if (is_non_zero) {
+    // an addition of p1 and -p2 leaves z = 0, and every later addition
+    // keeps it there.  This can happen in any comb row, not only in the
+    // last one, so z = 0 does not mean that the sum is infinity.  Compute
+    // both products separately then; point_add handles every case.
+    z = jres.z;
+    bn_mod(&z, prime);
+    if (bn_is_zero(&z)) {
+      curve_point q;
+      scalar_multiply(curve, k1, res);
+      point_multiply(curve, k2, p, &q);
+      point_add(curve, &q, res);
+      return;
+    }
+    jacobian_to_curve(&jres, res, prime);
+  } else {
+    point_set_infinity(res);
+  }
+}
+
+// returns the len <= 16 bits of a from bit pos on, bits above the
+// normalized limbs are zero.
+static inline uint32_t bn_get_bits(const bignum256 *a, int pos, int len) {
+  const int j = pos / 30;
+  const int shift = pos % 30;
+  uint32_t bits;
+
+  if (j > 8) {
+    return 0;
+  }
+  bits = a->val[j] >> shift;
+  if (shift + len > 30 && j < 8) {
+    bits |= a->val[j + 1] << (30 - shift);
+  }
+  return bits & ((1u << len) - 1);
+}
+
+// digit i of the signed w bit recoding of a used by point_multiply_multi,
+// a = sum d_i 2^(w i) with -2^(w-1) <= d_i <= 2^(w-1).  d_i is the window
+// of bits w i .. w i + w - 1 plus the bit below it as carry, minus 2^w if
+// the top bit of the window is set.  This needs no state from the lower
+// digits, so the digits are computed on the fly.
+static inline int point_multiply_multi_digit(const bignum256 *a, int i,
+                                             int w) {
+  int bits = bn_get_bits(a, w * i, w);
+  int d = bits - ((bits >> (w - 1)) << w);
+  if (i > 0) {
+    d += bn_get_bits(a, w * i - 1, 1);
+  }
+  return d;
+}
+
+// the window width for n points with scalars of at most the given bits.
+// Every window adds each point to a bucket (a mixed addition, 11M) and
+// sums up 2^(w - 1) buckets with two full additions (16M) each.
+static int point_multiply_multi_window(size_t n, int bits) {
+  int w, best = 1;
+  size_t cost, best_cost = (size_t)-1;
+
+  for (w = 1; w <= POINT_MULTIPLY_MULTI_MAX_WINDOW; w++) {
+    cost = (size_t)(bits / w + 1) * (11 * n + (16u << w));
+    if (cost < best_cost) {
+      best = w;
+      best_cost = cost;
+    }
+  }
+  return best;
+}
+
+// acc += p, where *is_non_zero tells if acc is not the point at infinity.
+static inline void point_multiply_multi_add(const ecdsa_curve *curve,
+                                            const jacobian_formulas *f,
+                                            const jacobian_curve_point *p,
+                                            jacobian_curve_point *acc,
+                                            uint8_t *is_non_zero) {
+  if (*is_non_zero) {
+    *is_non_zero = f->add_jacobian(p, acc, curve);
+  } else {
+    *acc = *p;
+    *is_non_zero = 1;
+  }
+}
+
+// jres = sum k[i] * p[i] with the bucket method of Pippenger.  The
+// windows are processed from the top, in each window every point is added
+// to the bucket of its digit and the weighted sum of the buckets is added
+// to jres with a running sum.  returns 0 if the sum is infinity.
+static int point_multiply_multi_jacobian(const ecdsa_curve *curve,
+                                         const bignum256 *k,
+                                         const curve_point *p, size_t n,
+                                         jacobian_curve_point *jres) {
+  jacobian_curve_point bucket[1 << (POINT_MULTIPLY_MULTI_MAX_WINDOW - 1)];
+  uint8_t used[1 << (POINT_MULTIPLY_MULTI_MAX_WINDOW - 1)];
+  jacobian_curve_point sum;
+  uint8_t sum_used, is_non_zero = 0;
+  curve_point q;
+  bignum256 all, z;
+  int i, j, w, d, bits, windows;
+  size_t m;
+  const bignum256 *prime = &curve->prime;
+  jacobian_formulas f;
+
+  jacobian_formulas_select(curve, &f);
+  bn_zero(&all);
+  for (m = 0; m < n; m++) {
+    assert(bn_is_less(&k[m], &curve->order));
+    for (j = 0; j < 9; j++) {
+      all.val[j] |= k[m].val[j];
+    }
+  }
+  bits = bn_bitcount(&all);
+  w = point_multiply_multi_window(n, bits);
+  // the top bit of the last window is zero, so it has no carry out.
+  windows = bits / w + 1;
+
+  for (i = windows - 1; i >= 0; i--) {
+    if (is_non_zero) {
+      for (j = 0; j < w; j++) {
+        f.dbl(jres, curve);
+      }
+    }
+    memset(used, 0, sizeof(used));
+    for (m = 0; m < n; m++) {
+      d = point_multiply_multi_digit(&k[m], i, w);
+      if (d == 0) {
+        continue;
+      }
+      q.x = p[m].x;
+      if (d > 0) {
+        q.y = p[m].y;
+      } else {
+        bn_subtract(prime, &p[m].y, &q.y);
+        d = -d;
+      }
+      if (used[d - 1]) {
+        f.add(&q, &bucket[d - 1], curve);
+        // p + (-p) leaves z = 0, as in point_multiply_dual
+        z = bucket[d - 1].z;
+        bn_mod(&z, prime);
+        used[d - 1] = !bn_is_zero(&z);
+      } else {
+        bucket[d - 1].x = q.x;
+        bucket[d - 1].y = q.y;
+        bn_one(&bucket[d - 1].z);
+        used[d - 1] = 1;
+      }
+    }
+    // jres += sum (d + 1) * bucket[d]
+    sum_used = 0;
+    for (d = (1 << (w - 1)) - 1; d >= 0; d--) {
+      if (used[d]) {
+        point_multiply_multi_add(curve, &f, &bucket[d], &sum, &sum_used);
+      }
+      if (sum_used) {
+        point_multiply_multi_add(curve, &f, &sum, jres, &is_non_zero);
+      }
+    }
+  }
+  return is_non_zero;
+}
+
+void point_multiply_multi(const ecdsa_curve *curve, const bignum256 *k,
+                          const curve_point *p, size_t n, curve_point *res) {
+  jacobian_curve_point jres;
+
+  if (point_multiply_multi_jacobian(curve, k, p, n, &jres)) {
+    jacobian_to_curve(&jres, res, &curve->prime);
+  } else {
+    point_set_infinity(res);
+  }
+}
+
+#if USE_SECP256K1_GLV
+void point_lambda(const curve_point *p, curve_point *res) {
+  res->x = p->x;
+  bn_multiply(&secp256k1_beta, &res->x, &secp256k1.prime);
+  bn_mod(&res->x, &secp256k1.prime);
+  res->y = p->y;
+}
 #endif
 
+void scalar_sequence_init(scalar_sequence *seq, const ecdsa_curve *curve,
+                          const bignum256 *k) {
+  assert(bn_is_less(k, &curve->order));
+  seq->curve = curve;
+  seq->k = *k;
+  seq->restart = 1;
+}
+
+void scalar_sequence_next(scalar_sequence *seq, curve_point *res, size_t n) {
+  const ecdsa_curve *curve = seq->curve;
+  jacobian_curve_point jres[SCALAR_MULTIPLY_BATCH_SIZE];
+  jacobian_formulas f;
+  bignum256 three;
+  size_t i, m;
+  uint32_t is_infinity;
+
+  jacobian_formulas_select(curve, &f);
+  bn_read_uint32(3, &three);
+  while (n > 0) {
+    m = n < SCALAR_MULTIPLY_BATCH_SIZE ? n : SCALAR_MULTIPLY_BATCH_SIZE;
+    is_infinity = 0;
+    for (i = 0; i < m; i++) {
+      if (seq->restart) {
+        // a full multiplication for the first point and after the
+        // points where adding G fails, see below.
+        scalar_multiply(curve, &seq->k, &res[i]);
+        if (point_is_infinity(&res[i])) {
+          is_infinity |= 1u << i;
+        } else {
+          curve_to_jacobian(&res[i], &seq->p, &curve->prime);
+        }
+      } else {
+        f.add(&curve->G, &seq->p, curve);
+      }
+      if (is_infinity & (1u << i)) {
+        // keep the batch inversion well defined, fixed up below
+        bn_one(&jres[i].x);
+        bn_one(&jres[i].y);
+        bn_one(&jres[i].z);
+      } else {
+        jres[i] = seq->p;
+      }
+      // k = k + 1 (mod order).  The addition formula does not handle
+      // G + G, -G + G and infinity + G, so restart if the old k was 1,
+      // order - 1 or 0, i.e., if the new k is 2, 0 or 1.
+      bn_addi(&seq->k, 1);
+      bn_mod(&seq->k, &curve->order);
+      seq->restart = bn_is_less(&seq->k, &three);
+    }
+    jacobian_to_curve_batch(jres, res, m, &curve->prime);
+    for (i = 0; i < m; i++) {
+      if (is_infinity & (1u << i)) {
+        point_set_infinity(&res[i]);
+      }
+    }
+    res += m;
+    n -= m;
+  }
+  memzero(jres, sizeof(jres));
+}
+
 int ecdh_multiply(const ecdsa_curve *curve, const uint8_t *priv_key,
                   const uint8_t *pub_key, uint8_t *session_key) {
   curve_point point;
@@ -650,6 +1687,117 @@ int ecdh_multiply(const ecdsa_curve *curve, const uint8_t *priv_key,
   return 0;
 }
 
+// signs digest with the rfc6979 nonces from rng.  See ecdsa_sign_digest.
+static int ecdsa_sign_digest_nonce(
+    const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest,
+    uint8_t *sig, uint8_t *pby,
+    int (*is_canonical)(uint8_t by, uint8_t sig[64]), rfc6979_state *rng) {
+  int i;
+  curve_point R;
+  bignum256 k, z, randk;
+  bignum256 *s = &R.y;
+  uint8_t by;  // signature recovery byte
+  int result = -1;
+
+  bn_read_be(digest, &z);
+  // z < 2^256 < 2 * order
+  bn_mod(&z, &curve->order);
+
+  for (i = 0; i < 10000; i++) {
+    // generate K deterministically
+    generate_k_rfc6979(&k, rng);
+    // if k is too big or too small, we don't like it
+    if (bn_is_zero(&k) || !bn_is_less(&k, &curve->order)) {
+      continue;
+    }
+
+    // compute k*G
+    scalar_multiply(curve, &k, &R);
+    by = R.y.val[0] & 1;
+    // r = (rx mod n)
+    if (!bn_is_less(&R.x, &curve->order)) {
+      bn_subtract(&R.x, &curve->order, &R.x);
+      by |= 2;
+    }
+    // if r is zero, we retry
+    if (bn_is_zero(&R.x)) {
+      continue;
+    }
+
+    // randomize operations to counter side-channel attacks
+    generate_k_random(&randk, &curve->order, random_default_ctx());
+    bn_multiply(&randk, &k, &curve->order);  // k*rand
+    bn_inverse(&k, &curve->order);           // (k*rand)^-1
+    bn_read_be(priv_key, s);                 // priv
+    bn_multiply(&R.x, s, &curve->order);     // R.x*priv
+    bn_add(s, &z);                           // R.x*priv + z
+    bn_multiply(&k, s, &curve->order);       // (k*rand)^-1 (R.x*priv + z)
+    bn_multiply(&randk, s, &curve->order);   // k^-1 (R.x*priv + z)
+    bn_mod(s, &curve->order);
+    // if s is zero, we retry
+    if (bn_is_zero(s)) {
+      continue;
+    }
+
+    // if S > order/2 => S = -S
+    if (bn_is_less(&curve->order_half, s)) {
+      bn_subtract(&curve->order, s, s);
+      by ^= 1;
+    }
+    // we are done, R.x and s is the result signature
+    bn_write_be(&R.x, sig);
+    bn_write_be(s, sig + 32);
+
+    // check if the signature is acceptable or retry
+    if (is_canonical && !is_canonical(by, sig)) {
+      continue;
+    }
+
+    if (pby) {
+      *pby = by;
+    }
+    result = 0;
+    break;
+  }
+
+  memzero(&k, sizeof(k));
+  memzero(&randk, sizeof(randk));
+  memzero(&R, sizeof(R));
+  memzero(&z, sizeof(z));
+  if (result != 0) {
+    // Too many retries without a valid signature
+    // -> fail with an error
+    memzero(sig, 64);
+  }
+  return result;
+}
+
+int ecdsa_sign_digest_key(const ecdsa_curve *curve,
+                          const struct rfc6979_key *key, const uint8_t *digest,
+                          uint8_t *sig, uint8_t *pby,
+                          int (*is_canonical)(uint8_t by, uint8_t sig[64])) {
+  rfc6979_state rng;
+  int result;
+
+  init_rfc6979(key, digest, curve, &rng);
+  result = ecdsa_sign_digest_nonce(curve, key->x, digest, sig, pby,
+                                   is_canonical, &rng);
+  memzero(&rng, sizeof(rng));
+  return result;
+}
+
+int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key,
+                      const uint8_t *digest, uint8_t *sig, uint8_t *pby,
+                      int (*is_canonical)(uint8_t by, uint8_t sig[64])) {
+  rfc6979_key key;
+  int result;
+
+  init_rfc6979_key(priv_key, &key);
+  result = ecdsa_sign_digest_key(curve, &key, digest, sig, pby, is_canonical);
+  memzero(&key, sizeof(key));
+  return result;
+}
+
 void ecdsa_get_public_key65(const ecdsa_curve *curve, const uint8_t *priv_key,
                             uint8_t *pub_key) {
   curve_point R;
@@ -665,6 +1813,113 @@ void ecdsa_get_public_key65(const ecdsa_curve *curve, const uint8_t *priv_key,
   memzero(&k, sizeof(k));
 }
 
+void ecdsa_get_public_key33(const ecdsa_curve *curve, const uint8_t *priv_key,
+                            uint8_t *pub_key) {
+  curve_point R;
+  bignum256 k;
+
+  bn_read_be(priv_key, &k);
+  // compute k*G
+  scalar_multiply(curve, &k, &R);
+  compress_coords(&R, pub_key);
+  memzero(&R, sizeof(R));
+  memzero(&k, sizeof(k));
+}
+
+// writes n public keys back to back with a stride of 33 bytes
+// (compressed) or 65 bytes (uncompressed), so the buffer can be fed to
+// the hash functions directly.
+static void ecdsa_write_public_keys(const curve_point *R, size_t n,
+                                    uint8_t *pub_keys, int compressed) {
+  const size_t stride = compressed ? 33 : 65;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    uint8_t *pub_key = pub_keys + stride * i;
+    if (compressed) {
+      compress_coords(&R[i], pub_key);
+    } else {
+      pub_key[0] = 0x04;
+      bn_write_be(&R[i].x, pub_key + 1);
+      bn_write_be(&R[i].y, pub_key + 33);
+    }
+  }
+}
+
+// pub_keys = priv_keys * G for n private keys of 32 bytes each.
+static void ecdsa_get_public_keys(const ecdsa_curve *curve,
+                                  const uint8_t *priv_keys, size_t n,
+                                  uint8_t *pub_keys, int compressed) {
+  bignum256 k[SCALAR_MULTIPLY_BATCH_SIZE];
+  curve_point R[SCALAR_MULTIPLY_BATCH_SIZE];
+  const size_t stride = compressed ? 33 : 65;
+  size_t i, m;
+
+  while (n > 0) {
+    m = n < SCALAR_MULTIPLY_BATCH_SIZE ? n : SCALAR_MULTIPLY_BATCH_SIZE;
+    for (i = 0; i < m; i++) {
+      bn_read_be(priv_keys + 32 * i, &k[i]);
+    }
+    // compute k*G
+    scalar_multiply_batch(curve, k, R, m);
+    ecdsa_write_public_keys(R, m, pub_keys, compressed);
+    priv_keys += 32 * m;
+    pub_keys += stride * m;
+    n -= m;
+  }
+  memzero(R, sizeof(R));
+  memzero(k, sizeof(k));
+}
+
+void ecdsa_get_public_key33_batch(const ecdsa_curve *curve,
+                                  const uint8_t *priv_keys, size_t n,
+                                  uint8_t *pub_keys) {
+  ecdsa_get_public_keys(curve, priv_keys, n, pub_keys, 1);
+}
+
+void ecdsa_get_public_key65_batch(const ecdsa_curve *curve,
+                                  const uint8_t *priv_keys, size_t n,
+                                  uint8_t *pub_keys) {
+  ecdsa_get_public_keys(curve, priv_keys, n, pub_keys, 0);
+}
+
+// pub_keys = (priv_key + i) * G for i = 0..n-1, see scalar_sequence.
+static void ecdsa_get_public_key_sequence(const ecdsa_curve *curve,
+                                          const uint8_t *priv_key, size_t n,
+                                          uint8_t *pub_keys, int compressed) {
+  scalar_sequence seq;
+  bignum256 k;
+  curve_point R[SCALAR_MULTIPLY_BATCH_SIZE];
+  const size_t stride = compressed ? 33 : 65;
+  size_t m;
+
+  bn_read_be(priv_key, &k);
+  bn_mod(&k, &curve->order);
+  scalar_sequence_init(&seq, curve, &k);
+  while (n > 0) {
+    m = n < SCALAR_MULTIPLY_BATCH_SIZE ? n : SCALAR_MULTIPLY_BATCH_SIZE;
+    scalar_sequence_next(&seq, R, m);
+    ecdsa_write_public_keys(R, m, pub_keys, compressed);
+    pub_keys += stride * m;
+    n -= m;
+  }
+  memzero(&seq, sizeof(seq));
+  memzero(&k, sizeof(k));
+  memzero(R, sizeof(R));
+}
+
+void ecdsa_get_public_key33_sequence(const ecdsa_curve *curve,
+                                     const uint8_t *priv_key, size_t n,
+                                     uint8_t *pub_keys) {
+  ecdsa_get_public_key_sequence(curve, priv_key, n, pub_keys, 1);
+}
+
+void ecdsa_get_public_key65_sequence(const ecdsa_curve *curve,
+                                     const uint8_t *priv_key, size_t n,
+                                     uint8_t *pub_keys) {
+  ecdsa_get_public_key_sequence(curve, priv_key, n, pub_keys, 0);
+}
+
 int ecdsa_read_pubkey(const ecdsa_curve *curve, const uint8_t *pub_key,
                       curve_point *pub) {
   if (!curve) {
@@ -693,7 +1948,7 @@ void uncompress_coords(const ecdsa_curve *curve, uint8_t odd,
                        const bignum256 *x, bignum256 *y) {
   // y^2 = x^3 + a*x + b
   memcpy(y, x, sizeof(bignum256));       // y is x
-  bn_multiply(x, y, &curve->prime);      // y is x^2
+  bn_square(y, &curve->prime);           // y is x^2
   bn_subi(y, -curve->a, &curve->prime);  // y is x^2 + a
   bn_multiply(x, y, &curve->prime);      // y is x^3 + ax
   bn_add(y, &curve->b);                  // y is x^3 + ax + b
@@ -719,11 +1974,11 @@ int ecdsa_validate_pubkey(const ecdsa_curve *curve, const curve_point *pub) {
   memcpy(&x3_ax_b, &(pub->x), sizeof(bignum256));
 
   // y^2
-  bn_multiply(&(pub->y), &y_2, &curve->prime);
+  bn_square(&y_2, &curve->prime);
   bn_mod(&y_2, &curve->prime);
 
   // x^3 + ax + b
-  bn_multiply(&(pub->x), &x3_ax_b, &curve->prime);  // x^2
+  bn_square(&x3_ax_b, &curve->prime);               // x^2
   bn_subi(&x3_ax_b, -curve->a, &curve->prime);      // x^2 + a
   bn_multiply(&(pub->x), &x3_ax_b, &curve->prime);  // x^3 + ax
   bn_addmod(&x3_ax_b, &curve->b, &curve->prime);    // x^3 + ax + b
@@ -735,3 +1990,58 @@ int ecdsa_validate_pubkey(const ecdsa_curve *curve, const curve_point *pub) {
 
   return 1;
 }
+
+// Verifies that the signature r || s is valid for digest and pub_key.
+// returns 0 if verification succeeded
+int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key,
+                        const uint8_t *sig, const uint8_t *digest) {
+  curve_point pub, res;
+  bignum256 r, s, z;
+  int result = 0;
+
+  if (!ecdsa_read_pubkey(curve, pub_key, &pub)) {
+    result = 1;
+  }
+
+  if (result == 0) {
+    bn_read_be(sig, &r);
+    bn_read_be(sig + 32, &s);
+    bn_read_be(digest, &z);
+    if (bn_is_zero(&r) || bn_is_zero(&s) ||
+        (!bn_is_less(&r, &curve->order)) ||
+        (!bn_is_less(&s, &curve->order))) {
+      result = 2;
+    }
+  }
+
+  if (result == 0) {
+    // z < 2^256 < 2 * order
+    bn_mod(&z, &curve->order);
+    bn_inverse(&s, &curve->order);       // s = s^-1
+    bn_multiply(&s, &z, &curve->order);  // z = z * s  [u1 = z * s^-1 mod n]
+    bn_mod(&z, &curve->order);
+    bn_multiply(&r, &s, &curve->order);  // s = r * s  [u2 = r * s^-1 mod n]
+    bn_mod(&s, &curve->order);
+
+    // res = u1 * G + u2 * pub
+    point_multiply_dual(curve, &z, &s, &pub, &res);
+    if (point_is_infinity(&res)) {
+      result = 3;
+    }
+  }
+
+  if (result == 0) {
+    bn_mod(&(res.x), &curve->order);
+    // signature does not match
+    if (!bn_is_equal(&res.x, &r)) {
+      result = 4;
+    }
+  }
+
+  memzero(&pub, sizeof(pub));
+  memzero(&res, sizeof(res));
+  memzero(&r, sizeof(r));
+  memzero(&s, sizeof(s));
+  memzero(&z, sizeof(z));
+  return result;
+}
@@ -26,8 +26,14 @@
 
 #include <stdint.h>
 #include "bignum.h"
+#include "bignum_x4.h"
 #include "options.h"
 
+// dimensions of the precomputed comb table curve->cp
+#define PRECOMPUTED_CP_ROWS \
+  ((256 + PRECOMPUTED_CP_WINDOW - 1) / PRECOMPUTED_CP_WINDOW)
+#define PRECOMPUTED_CP_POINTS (1 << (PRECOMPUTED_CP_WINDOW - 1))
+
 // curve point x and y
 typedef struct {
   bignum256 x, y;
@@ -42,11 +48,43 @@ typedef struct {
   bignum256 b;           // coefficient 'b' of the elliptic curve
 
 #if USE_PRECOMPUTED_CP
-  const curve_point cp[64][8];
+  const curve_point cp[PRECOMPUTED_CP_ROWS][PRECOMPUTED_CP_POINTS];
 #endif
 
 } ecdsa_curve;
 
+// curve point in jacobian coordinates (x/z^2, y/z^3)
+typedef struct jacobian_curve_point {
+  bignum256 x, y, z;
+} jacobian_curve_point;
+
+#if USE_BN_X4
+// four curve points in affine and jacobian coordinates, one per lane
+typedef struct {
+  bignum256x4 x, y;
+} curve_point_x4;
+
+typedef struct {
+  bignum256x4 x, y, z;
+} jacobian_curve_point_x4;
+#endif
+
+// number of points scalar_multiply_batch normalizes with one inversion
+#define SCALAR_MULTIPLY_BATCH_SIZE 16
+
+// state for computing the public keys of consecutive private keys
+// k, k + 1, k + 2, ... with one point addition per key.
+// Holds secret data, memzero it when done.
+typedef struct {
+  const ecdsa_curve *curve;
+  bignum256 k;             // the next scalar
+  jacobian_curve_point p;  // (k - 1) * G unless restart is set
+  int restart;             // compute k * G from scratch
+} scalar_sequence;
+
+// cached nonce derivation state of a private key, see rfc6979.h
+struct rfc6979_key;
+
 // 4 byte prefix + 40 byte data (segwit)
 // 1 byte prefix + 64 byte data (cashaddr)
 #define MAX_ADDR_RAW_SIZE 65
@@ -72,17 +110,112 @@ int point_is_equal(const curve_point *p, const curve_point *q);
 int point_is_negative_of(const curve_point *p, const curve_point *q);
 void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k,
                      curve_point *res);
+void scalar_multiply_batch(const ecdsa_curve *curve, const bignum256 *k,
+                           curve_point *res, size_t n);
+// res = k1 * G + k2 * p, not constant time
+void point_multiply_dual(const ecdsa_curve *curve, const bignum256 *k1,
+                         const bignum256 *k2, const curve_point *p,
+                         curve_point *res);
+// res = sum k[i] * p[i] for i = 0..n-1, not constant time.  The k[i]
+// must be normalized and below curve->order, no p[i] may be infinity.
+// Short scalars are cheaper: the cost follows the longest k[i].
+void point_multiply_multi(const ecdsa_curve *curve, const bignum256 *k,
+                          const curve_point *p, size_t n, curve_point *res);
+#if USE_SECP256K1_GLV
+// res = lambda * p = (beta * x, y) for a point p on secp256k1, see
+// scalar_split_lambda
+void point_lambda(const curve_point *p, curve_point *res);
+#endif
+#if USE_BN_X4
+void point_jacobian_add_x4(const curve_point_x4 *p1,
+                           jacobian_curve_point_x4 *p2,
+                           const ecdsa_curve *curve);
+#if USE_PRECOMPUTED_CP
+int scalar_multiply_jacobian_x4(const ecdsa_curve *curve, const bignum256 *k,
+                                jacobian_curve_point *jres);
+#endif
+#endif
+#if USE_RUNTIME_CP
+// builds the runtime comb table now instead of on the first scalar_multiply.
+// returns 0 if it could not be allocated, the precomputed table is used then.
+int scalar_multiply_runtime_init(void);
+// maps a table file built by tools/mkcpfile.py read-only and uses it as the
+// runtime comb table, so that processes share one copy in the page cache.
+// The points must hash to the sha256 compiled in for their window width,
+// and the first point of every row must be 2^(w*i) * G.  Must be called
+// before the first scalar_multiply.
+// Hashing reads the whole file: about 0.3 s for the 36 MiB w = 16 table on
+// one x86-64 core, against a few ms to map it.
+// returns 0 if the file is missing or invalid or a runtime table is
+// already in use.
+int scalar_multiply_runtime_load(const char *path);
+// scalar_multiply_runtime_load without hashing the points, for processes
+// that map a file whose points were already hashed, e.g. workers started
+// after their parent loaded the same file with
+// scalar_multiply_runtime_load.  The header hash must still equal the
+// pinned one and the rows are checked, but a point changed in place since
+// the first load goes unnoticed, so the file must not be writable by
+// anyone the workers do not trust.
+int scalar_multiply_runtime_load_checked(const char *path);
+// returns 1 if the kernel accepted the hugepage advice for the runtime
+// table, 0 if it refused it or USE_RUNTIME_CP_HUGEPAGES is off, and -1 if
+// there is no runtime table yet.  An accepted advice does not mean the
+// table is backed by hugepages, AnonHugePages and FilePmdMapped in
+// /proc/self/smaps tell that, see tools/bench_comb.c.
+int scalar_multiply_runtime_hugepages(void);
+#endif
+void jacobian_to_curve_batch(const jacobian_curve_point *jp, curve_point *p,
+                             size_t n, const bignum256 *prime);
+// starts a sequence at k, k must be a normalized number with
+// 0 <= k < curve->order
+void scalar_sequence_init(scalar_sequence *seq, const ecdsa_curve *curve,
+                          const bignum256 *k);
+// res[i] = (k + i) * G  for i = 0..n-1 and advances k by n, where k + i
+// wraps around modulo curve->order.  Every chunk of
+// SCALAR_MULTIPLY_BATCH_SIZE points is converted to affine coordinates
+// with one inversion.
+void scalar_sequence_next(scalar_sequence *seq, curve_point *res, size_t n);
 int ecdh_multiply(const ecdsa_curve *curve, const uint8_t *priv_key,
                   const uint8_t *pub_key, uint8_t *session_key);
 void compress_coords(const curve_point *cp, uint8_t *compressed);
 void uncompress_coords(const ecdsa_curve *curve, uint8_t odd,
                        const bignum256 *x, bignum256 *y);
 
+void ecdsa_get_public_key33(const ecdsa_curve *curve, const uint8_t *priv_key,
+                            uint8_t *pub_key);
 void ecdsa_get_public_key65(const ecdsa_curve *curve, const uint8_t *priv_key,
                             uint8_t *pub_key);
+void ecdsa_get_public_key33_batch(const ecdsa_curve *curve,
+                                  const uint8_t *priv_keys, size_t n,
+                                  uint8_t *pub_keys);
+void ecdsa_get_public_key65_batch(const ecdsa_curve *curve,
+                                  const uint8_t *priv_keys, size_t n,
+                                  uint8_t *pub_keys);
+void ecdsa_get_public_key33_sequence(const ecdsa_curve *curve,
+                                     const uint8_t *priv_key, size_t n,
+                                     uint8_t *pub_keys);
+void ecdsa_get_public_key65_sequence(const ecdsa_curve *curve,
+                                     const uint8_t *priv_key, size_t n,
+                                     uint8_t *pub_keys);
 int ecdsa_read_pubkey(const ecdsa_curve *curve, const uint8_t *pub_key,
                       curve_point *pub);
 int ecdsa_validate_pubkey(const ecdsa_curve *curve, const curve_point *pub);
+// signs a 32 byte digest with a low s, writes the 64 byte signature r || s
+// to sig and the recovery id to pby if it is not NULL.  is_canonical may
+// reject signatures, a new nonce is used then.  returns 0 on success.
+int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key,
+                      const uint8_t *digest, uint8_t *sig, uint8_t *pby,
+                      int (*is_canonical)(uint8_t by, uint8_t sig[64]));
+// ecdsa_sign_digest with the private key given as its rfc6979 state from
+// init_rfc6979_key, for signing many digests with the same key.
+int ecdsa_sign_digest_key(const ecdsa_curve *curve,
+                          const struct rfc6979_key *key, const uint8_t *digest,
+                          uint8_t *sig, uint8_t *pby,
+                          int (*is_canonical)(uint8_t by, uint8_t sig[64]));
+// verifies the 64 byte signature r || s of a 32 byte digest.
+// returns 0 if the signature is valid.
+int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key,
+                        const uint8_t *sig, const uint8_t *digest);
 void compress_coords(const curve_point *cp, uint8_t *compressed);
 void uncompress_coords(const ecdsa_curve *curve, uint8_t odd,
                        const bignum256 *x, bignum256 *y);
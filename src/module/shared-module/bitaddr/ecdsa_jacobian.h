@@ -0,0 +1,459 @@
+/**
+ * Copyright (c) 2013-2014 Tomas Dzetkulic
+ * Copyright (c) 2013-2014 Pavol Rusnak
+ * Copyright (c)      2015 Jochen Hoenicke
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Jacobian point formulas, instantiated by ecdsa.c once per curve.
+// This file has no include guard: every inclusion expects
+//   JACOBIAN_FN(name)        the name of the instantiated function
+//   JACOBIAN_STORAGE         storage class of the functions
+//   JACOBIAN_CURVE_A         coefficient a, a constant for specialized curves
+//   JACOBIAN_MULTIPLY(k, x)  x = k * x mod prime
+//   JACOBIAN_SQUARE(x)       x = x * x mod prime
+// and undefines them at the end.  With constant JACOBIAN_CURVE_A the
+// compiler drops the code for the a-terms that vanish.
+
+JACOBIAN_STORAGE void JACOBIAN_FN(point_jacobian_add)(
+    const curve_point *p1, jacobian_curve_point *p2, const ecdsa_curve *curve) {
+  bignum256 r, h, r2;
+  bignum256 hcby, hsqx;
+  bignum256 xz, yz, az;
+  int is_doubling;
+  const bignum256 *prime = &curve->prime;
+  const int a = JACOBIAN_CURVE_A;
+
+  assert(-3 <= a && a <= 0);
+
+  /* First we bring p1 to the same denominator:
+   * x1' := x1 * z2^2
+   * y1' := y1 * z2^3
+   */
+  /*
+   * lambda  = ((y1' - y2)/z2^3) / ((x1' - x2)/z2^2)
+   *         = (y1' - y2) / (x1' - x2) z2
+   * x3/z3^2 = lambda^2 - (x1' + x2)/z2^2
+   * y3/z3^3 = 1/2 lambda * (2x3/z3^2 - (x1' + x2)/z2^2) + (y1'+y2)/z2^3
+   *
+   * For the special case x1=x2, y1=y2 (doubling) we have
+   * lambda = 3/2 ((x2/z2^2)^2 + a) / (y2/z2^3)
+   *        = 3/2 (x2^2 + a*z2^4) / y2*z2)
+   *
+   * to get rid of fraction we write lambda as
+   * lambda = r / (h*z2)
+   * with  r = is_doubling ? 3/2 x2^2 + az2^4 : (y1 - y2)
+   *       h = is_doubling ?      y1+y2       : (x1 - x2)
+   *
+   * With z3 = h*z2  (the denominator of lambda)
+   * we get x3 = lambda^2*z3^2 - (x1' + x2)/z2^2*z3^2
+   *           = r^2 - h^2 * (x1' + x2)
+   *    and y3 = 1/2 r * (2x3 - h^2*(x1' + x2)) + h^3*(y1' + y2)
+   */
+
+  /* h = x1 - x2
+   * r = y1 - y2
+   * x3 = r^2 - h^3 - 2*h^2*x2
+   * y3 = r*(h^2*x2 - x3) - h^3*y2
+   * z3 = h*z2
+   */
+
+  // magnitudes (multiples of prime) are noted in brackets, see
+  // point_jacobian_double.
+  assert(bn_is_magnitude(&p2->x, 2, prime));
+  assert(bn_is_magnitude(&p2->y, 2, prime));
+  assert(bn_is_magnitude(&p2->z, 2, prime));
+
+  xz = p2->z;
+  JACOBIAN_SQUARE(&xz);         // xz = z2^2
+  yz = p2->z;
+  JACOBIAN_MULTIPLY(&xz, &yz);  // yz = z2^3
+
+  if (a != 0) {
+    az = xz;
+    JACOBIAN_SQUARE(&az);      // az = z2^4
+    bn_mult_k(&az, -a, prime);  // az = -az2^4
+  }
+
+  JACOBIAN_MULTIPLY(&p1->x, &xz);  // xz = x1' = x1*z2^2;
+  h = xz;
+  bn_subtractmod(&h, &p2->x, &h, prime);
+  bn_fast_mod(&h, prime);
+  // h = x1' - x2;  [2]
+
+  bn_add(&xz, &p2->x);
+  // xz = x1' + x2  [4]
+
+  // check for h == 0 % prime.  Note that h never normalizes to
+  // zero, since h = x1' + 2*prime - x2 > 0 and a positive
+  // multiple of prime is always normalized to prime by
+  // bn_fast_mod.
+  is_doubling = bn_is_equal(&h, prime);
+
+  JACOBIAN_MULTIPLY(&p1->y, &yz);  // yz = y1' = y1*z2^3;
+  bn_subtractmod(&yz, &p2->y, &r, prime);
+  // r = y1' - y2;  [4]
+
+  bn_add(&yz, &p2->y);
+  // yz = y1' + y2  [4]
+
+  r2 = p2->x;
+  JACOBIAN_SQUARE(&r2);
+  bn_mult_k(&r2, 3, prime);
+
+  if (a != 0) {
+    // subtract -a z2^4, i.e, add a z2^4
+    bn_subtractmod(&r2, &az, &r2, prime);
+  }
+  bn_cmov(&r, is_doubling, &r2, &r);
+  bn_cmov(&h, is_doubling, &yz, &h);
+
+  // hsqx = h^2
+  hsqx = h;
+  JACOBIAN_SQUARE(&hsqx);
+
+  // hcby = h^3
+  hcby = h;
+  JACOBIAN_MULTIPLY(&hsqx, &hcby);
+
+  // hsqx = h^2 * (x1 + x2)
+  JACOBIAN_MULTIPLY(&xz, &hsqx);
+
+  // hcby = h^3 * (y1 + y2)
+  JACOBIAN_MULTIPLY(&yz, &hcby);
+
+  // z3 = h*z2
+  JACOBIAN_MULTIPLY(&h, &p2->z);
+
+  // x3 = r^2 - h^2 (x1 + x2)
+  p2->x = r;
+  JACOBIAN_SQUARE(&p2->x);
+  bn_subtractmod(&p2->x, &hsqx, &p2->x, prime);
+  bn_fast_mod(&p2->x, prime);  // [2]
+
+  // y3 = 1/2 (r*(h^2 (x1 + x2) - 2x3) - h^3 (y1 + y2))
+  bn_subtractmod(&hsqx, &p2->x, &p2->y, prime);
+  bn_subtractmod(&p2->y, &p2->x, &p2->y, prime);  // [6]
+  JACOBIAN_MULTIPLY(&r, &p2->y);
+  bn_subtractmod(&p2->y, &hcby, &p2->y, prime);
+  bn_mult_half(&p2->y, prime);
+  bn_fast_mod(&p2->y, prime);  // [2]
+}
+
+// mixed addition p2 = p1 + p2 without the doubling case (madd-2007-bl).
+// Costs 7M + 4S against 8M + 4S for point_jacobian_add.  p2 may not be
+// infinity and p1 != +-p2, otherwise p2->z is zero afterwards.  The
+// comb rows of scalar_multiply other than the last meet this, see
+// scalar_multiply_jacobian.
+JACOBIAN_STORAGE void JACOBIAN_FN(point_jacobian_madd)(
+    const curve_point *p1, jacobian_curve_point *p2,
+    const ecdsa_curve *curve) {
+  bignum256 z2z2, u1, s1, h, hh, i, j, r, v, t;
+  const bignum256 *prime = &curve->prime;
+
+  /* With u1 = x1 z2^2, s1 = y1 z2^3, h = u1 - x2, i = 4 h^2, j = h i,
+   * r = 2 (s1 - y2) and v = x2 i:
+   *   x3 = r^2 - j - 2 v
+   *   y3 = r (v - x3) - 2 y2 j
+   *   z3 = (z2 + h)^2 - z2^2 - h^2 = 2 z2 h
+   * The factors 2 and 4 scale x3, y3 and z3 consistently and save the
+   * multiplication z2 h.
+   */
+
+  assert(bn_is_magnitude(&p2->x, 2, prime));
+  assert(bn_is_magnitude(&p2->y, 2, prime));
+  assert(bn_is_magnitude(&p2->z, 2, prime));
+
+  z2z2 = p2->z;
+  JACOBIAN_SQUARE(&z2z2);
+  u1 = p1->x;
+  JACOBIAN_MULTIPLY(&z2z2, &u1);
+  s1 = p1->y;
+  JACOBIAN_MULTIPLY(&p2->z, &s1);
+  JACOBIAN_MULTIPLY(&z2z2, &s1);
+
+  bn_subtractmod(&u1, &p2->x, &h, prime);  // [4]
+  hh = h;
+  JACOBIAN_SQUARE(&hh);
+  i = hh;
+  bn_mult_k(&i, 4, prime);  // [2]
+  j = h;
+  JACOBIAN_MULTIPLY(&i, &j);
+  bn_subtractmod(&s1, &p2->y, &r, prime);
+  bn_lshift(&r);  // [8]
+  v = p2->x;
+  JACOBIAN_MULTIPLY(&i, &v);
+
+  // z3 = (z2 + h)^2 - z2^2 - h^2
+  bn_add(&p2->z, &h);  // [6]
+  JACOBIAN_SQUARE(&p2->z);
+  bn_subtractmod(&p2->z, &z2z2, &p2->z, prime);
+  bn_subtractmod(&p2->z, &hh, &p2->z, prime);
+  bn_fast_mod(&p2->z, prime);  // [2]
+
+  // t = 2 y2 j, read before y2 is overwritten
+  t = p2->y;
+  JACOBIAN_MULTIPLY(&j, &t);
+  bn_lshift(&t);
+  bn_fast_mod(&t, prime);  // [2]
+
+  // x3 = r^2 - j - 2 v
+  p2->x = r;
+  JACOBIAN_SQUARE(&p2->x);
+  bn_subtractmod(&p2->x, &j, &p2->x, prime);
+  bn_subtractmod(&p2->x, &v, &p2->x, prime);
+  bn_subtractmod(&p2->x, &v, &p2->x, prime);
+  bn_fast_mod(&p2->x, prime);  // [2]
+
+  // y3 = r (v - x3) - 2 y2 j
+  bn_subtractmod(&v, &p2->x, &p2->y, prime);  // [4]
+  JACOBIAN_MULTIPLY(&r, &p2->y);
+  bn_subtractmod(&p2->y, &t, &p2->y, prime);
+  bn_fast_mod(&p2->y, prime);  // [2]
+}
+
+// co-Z addition (ZADDU), p1 and p2 must share the same z.
+// p2 = p1 + p2 and p1 is rewritten to the same point with the new z of
+// p2, so both share z again.  Costs 5M + 2S.  Neither point may be
+// infinity and p1 != +-p2, which holds when adding multiples of a point
+// of large order, see point_multiply.
+JACOBIAN_STORAGE void JACOBIAN_FN(point_jacobian_add_coz)(
+    jacobian_curve_point *p1, jacobian_curve_point *p2,
+    const ecdsa_curve *curve) {
+  bignum256 h, r, w1, w2;
+  const bignum256 *prime = &curve->prime;
+
+  /* With the common denominator z:
+   * lambda  = (y1 - y2) / ((x1 - x2) z)
+   *
+   * With z3 = (x1 - x2) z, h = x1 - x2 and r = y1 - y2
+   *   w1 = x1 h^2,  w2 = x2 h^2
+   *   x3 = r^2 - w1 - w2
+   *   y3 = r (w1 - x3) - y1 h^3,  where h^3 = w1 - w2
+   * and p1 = (w1, y1 h^3, z3) over the new denominator.
+   */
+
+  assert(bn_is_magnitude(&p1->x, 2, prime));
+  assert(bn_is_magnitude(&p1->y, 2, prime));
+  assert(bn_is_magnitude(&p2->x, 2, prime));
+  assert(bn_is_magnitude(&p2->y, 2, prime));
+  assert(bn_is_magnitude(&p2->z, 2, prime));
+
+  bn_subtractmod(&p1->x, &p2->x, &h, prime);  // [4]
+  bn_subtractmod(&p1->y, &p2->y, &r, prime);  // [4]
+
+  // z3 = h z
+  JACOBIAN_MULTIPLY(&h, &p2->z);
+
+  // w1 = x1 h^2, w2 = x2 h^2
+  JACOBIAN_SQUARE(&h);
+  w1 = p1->x;
+  JACOBIAN_MULTIPLY(&h, &w1);
+  w2 = p2->x;
+  JACOBIAN_MULTIPLY(&h, &w2);
+
+  // p1->y = y1 h^3
+  bn_subtractmod(&w1, &w2, &h, prime);
+  JACOBIAN_MULTIPLY(&h, &p1->y);
+
+  // x3 = r^2 - w1 - w2
+  p2->x = r;
+  JACOBIAN_SQUARE(&p2->x);
+  bn_subtractmod(&p2->x, &w1, &p2->x, prime);
+  bn_subtractmod(&p2->x, &w2, &p2->x, prime);
+  bn_fast_mod(&p2->x, prime);  // [2]
+
+  // y3 = r (w1 - x3) - y1 h^3
+  bn_subtractmod(&w1, &p2->x, &p2->y, prime);
+  JACOBIAN_MULTIPLY(&r, &p2->y);
+  bn_subtractmod(&p2->y, &p1->y, &p2->y, prime);
+  bn_fast_mod(&p2->y, prime);  // [2]
+
+  p1->x = w1;
+  p1->z = p2->z;
+}
+
+JACOBIAN_STORAGE void JACOBIAN_FN(point_jacobian_double)(
+    jacobian_curve_point *p, const ecdsa_curve *curve) {
+  bignum256 az4, m, msq, ysq, xysq;
+  const bignum256 *prime = &curve->prime;
+
+  assert(-3 <= JACOBIAN_CURVE_A && JACOBIAN_CURVE_A <= 0);
+  /* usual algorithm:
+   *
+   * lambda  = (3((x/z^2)^2 + a) / 2y/z^3) = (3x^2 + az^4)/2yz
+   * x3/z3^2 = lambda^2 - 2x/z^2
+   * y3/z3^3 = lambda * (x/z^2 - x3/z3^2) - y/z^3
+   *
+   * to get rid of fraction we set
+   *  m = (3 x^2 + az^4) / 2
+   * Hence,
+   *  lambda = m / yz = m / z3
+   *
+   * With z3 = yz  (the denominator of lambda)
+   * we get x3 = lambda^2*z3^2 - 2*x/z^2*z3^2
+   *           = m^2 - 2*xy^2
+   *    and y3 = (lambda * (x/z^2 - x3/z3^2) - y/z^3) * z3^3
+   *           = m * (xy^2 - x3) - y^4
+   */
+
+  /* m = (3*x^2 + a z^4) / 2
+   * x3 = m^2 - 2*xy^2
+   * y3 = m*(xy^2 - x3) - 8y^4
+   * z3 = y*z
+   */
+
+  // magnitudes (multiples of prime) are noted in brackets.  The
+  // multiplications accept anything below 180p, so only values that
+  // are subtracted or leave the function are reduced to [2].
+  assert(bn_is_magnitude(&p->x, 2, prime));
+  assert(bn_is_magnitude(&p->y, 2, prime));
+  assert(bn_is_magnitude(&p->z, 2, prime));
+
+  m = p->x;
+  JACOBIAN_SQUARE(&m);
+  bn_mult_k(&m, 3, prime);  // [2]
+
+  if (JACOBIAN_CURVE_A != 0) {
+    // for a == 0 (secp256k1) the term and its two squarings vanish.
+    az4 = p->z;
+    JACOBIAN_SQUARE(&az4);
+    JACOBIAN_SQUARE(&az4);
+    bn_mult_k(&az4, -JACOBIAN_CURVE_A, prime);
+    bn_subtractmod(&m, &az4, &m, prime);  // [4]
+  }
+  // m is only used as a factor, so it is not reduced any further.
+  bn_mult_half(&m, prime);  // [3]
+
+  // msq = m^2
+  msq = m;
+  JACOBIAN_SQUARE(&msq);
+  // ysq = y^2
+  ysq = p->y;
+  JACOBIAN_SQUARE(&ysq);
+  // xysq = xy^2
+  xysq = p->x;
+  JACOBIAN_MULTIPLY(&ysq, &xysq);
+
+  // z3 = yz
+  JACOBIAN_MULTIPLY(&p->y, &p->z);
+
+  // x3 = m^2 - 2*xy^2
+  p->x = xysq;
+  bn_lshift(&p->x);
+  bn_fast_mod(&p->x, prime);  // [2]
+  bn_subtractmod(&msq, &p->x, &p->x, prime);
+  bn_fast_mod(&p->x, prime);  // [2]
+
+  // y3 = m*(xy^2 - x3) - y^4
+  bn_subtractmod(&xysq, &p->x, &p->y, prime);  // [4]
+  JACOBIAN_MULTIPLY(&m, &p->y);
+  JACOBIAN_SQUARE(&ysq);
+  bn_subtractmod(&p->y, &ysq, &p->y, prime);
+  bn_fast_mod(&p->y, prime);  // [2]
+}
+
+// p2 = p1 + p2 for two points in jacobian coordinates, not constant
+// time.  Neither point may be infinity.  returns 0 if the sum is the
+// point at infinity, p2->z is zero then.  Costs 12M + 4S.
+JACOBIAN_STORAGE int JACOBIAN_FN(point_jacobian_add_jacobian)(
+    const jacobian_curve_point *p1, jacobian_curve_point *p2,
+    const ecdsa_curve *curve) {
+  bignum256 z1z1, z2z2, u1, u2, s1, s2, h, r, t;
+  const bignum256 *prime = &curve->prime;
+
+  /* With u1 = x1 z2^2, u2 = x2 z1^2, s1 = y1 z2^3, s2 = y2 z1^3
+   * and h = u2 - u1, r = s2 - s1:
+   *   x3 = r^2 - h^3 - 2 u1 h^2
+   *   y3 = r (u1 h^2 - x3) - s1 h^3
+   *   z3 = z1 z2 h
+   */
+
+  assert(bn_is_magnitude(&p1->x, 2, prime));
+  assert(bn_is_magnitude(&p1->y, 2, prime));
+  assert(bn_is_magnitude(&p1->z, 2, prime));
+  assert(bn_is_magnitude(&p2->x, 2, prime));
+  assert(bn_is_magnitude(&p2->y, 2, prime));
+  assert(bn_is_magnitude(&p2->z, 2, prime));
+
+  z1z1 = p1->z;
+  JACOBIAN_SQUARE(&z1z1);
+  z2z2 = p2->z;
+  JACOBIAN_SQUARE(&z2z2);
+  u1 = p1->x;
+  JACOBIAN_MULTIPLY(&z2z2, &u1);
+  u2 = p2->x;
+  JACOBIAN_MULTIPLY(&z1z1, &u2);
+  s1 = p1->y;
+  JACOBIAN_MULTIPLY(&p2->z, &s1);
+  JACOBIAN_MULTIPLY(&z2z2, &s1);
+  s2 = p2->y;
+  JACOBIAN_MULTIPLY(&p1->z, &s2);
+  JACOBIAN_MULTIPLY(&z1z1, &s2);
+
+  bn_subtractmod(&u2, &u1, &h, prime);
+  bn_fast_mod(&h, prime);  // [2]
+  bn_subtractmod(&s2, &s1, &r, prime);
+  bn_fast_mod(&r, prime);  // [2]
+
+  // h and r never normalize to zero, see point_jacobian_add.
+  if (bn_is_equal(&h, prime)) {
+    if (bn_is_equal(&r, prime)) {
+      JACOBIAN_FN(point_jacobian_double)(p2, curve);
+      return 1;
+    }
+    bn_zero(&p2->z);
+    return 0;
+  }
+
+  // z3 = z1 z2 h
+  JACOBIAN_MULTIPLY(&p1->z, &p2->z);
+  JACOBIAN_MULTIPLY(&h, &p2->z);
+
+  // u1 = u1 h^2, h = h^3
+  t = h;
+  JACOBIAN_SQUARE(&t);
+  JACOBIAN_MULTIPLY(&t, &u1);
+  JACOBIAN_MULTIPLY(&t, &h);
+
+  // x3 = r^2 - h^3 - 2 u1 h^2
+  p2->x = r;
+  JACOBIAN_SQUARE(&p2->x);
+  bn_subtractmod(&p2->x, &h, &p2->x, prime);
+  t = u1;
+  bn_lshift(&t);
+  bn_fast_mod(&t, prime);  // [2]
+  bn_subtractmod(&p2->x, &t, &p2->x, prime);
+  bn_fast_mod(&p2->x, prime);  // [2]
+
+  // y3 = r (u1 h^2 - x3) - s1 h^3
+  bn_subtractmod(&u1, &p2->x, &p2->y, prime);  // [4]
+  JACOBIAN_MULTIPLY(&r, &p2->y);
+  JACOBIAN_MULTIPLY(&h, &s1);
+  bn_subtractmod(&p2->y, &s1, &p2->y, prime);
+  bn_fast_mod(&p2->y, prime);  // [2]
+  return 1;
+}
+
+#undef JACOBIAN_FN
+#undef JACOBIAN_STORAGE
+#undef JACOBIAN_CURVE_A
+#undef JACOBIAN_MULTIPLY
+#undef JACOBIAN_SQUARE
@@ -28,21 +28,117 @@
 #define USE_PRECOMPUTED_CP 1
 #endif
 
-// use fast inverse method
+// window width w of the precomputed comb table, which then has
+// ceil(256 / w) rows of 2^(w-1) points.  Larger windows need fewer point
+// additions per key but exponentially more flash.  Only the table for
+// w = 4 is checked in, other widths are generated by tools/mktable.py
+// and passed in via SECP256K1_CP_TABLE (see the atmel-samd Makefile).
+#ifndef PRECOMPUTED_CP_WINDOW
+#define PRECOMPUTED_CP_WINDOW 4
+#endif
+
+// build a comb table with RUNTIME_CP_WINDOW bit windows for secp256k1 on
+// the heap on first use and use it instead of the precomputed one.
+// For w = 16 this needs 36 MiB of RAM and pthreads, but only 15 point
+// additions per key, so it is meant for hosts doing bulk key generation.
+#ifndef USE_RUNTIME_CP
+#define USE_RUNTIME_CP 0
+#endif
+
+#ifndef RUNTIME_CP_WINDOW
+#define RUNTIME_CP_WINDOW 16
+#endif
+
+// ask for transparent hugepages for the runtime comb table
+#ifndef USE_RUNTIME_CP_HUGEPAGES
+#define USE_RUNTIME_CP_HUGEPAGES 1
+#endif
+
+#if USE_RUNTIME_CP && !USE_PRECOMPUTED_CP
+#error "USE_RUNTIME_CP requires USE_PRECOMPUTED_CP"
+#endif
+
+#if RUNTIME_CP_WINDOW < 2 || RUNTIME_CP_WINDOW > 16
+#error "RUNTIME_CP_WINDOW must be between 2 and 16"
+#endif
+
+// split the scalar of point_multiply for secp256k1 into two 128 bit
+// halves with the curve endomorphism (GLV), which halves the doublings
+#ifndef USE_SECP256K1_GLV
+#define USE_SECP256K1_GLV 1
+#endif
+
+// largest window of point_multiply_multi.  It keeps 2^(w - 1) jacobian
+// points of 108 bytes as buckets on the stack, w = 6 takes 3.5 KB.
+#ifndef POINT_MULTIPLY_MULTI_MAX_WINDOW
+#define POINT_MULTIPLY_MULTI_MAX_WINDOW 6
+#endif
+
+#if POINT_MULTIPLY_MULTI_MAX_WINDOW < 1 || POINT_MULTIPLY_MULTI_MAX_WINDOW > 16
+#error "POINT_MULTIPLY_MULTI_MAX_WINDOW must be between 1 and 16"
+#endif
+
+// signatures per multi multiplication in schnorr_verify_batch.  Each one
+// takes up to three points and scalars (324 bytes) of stack, larger
+// batches are cheaper per signature.
+#ifndef SCHNORR_VERIFY_BATCH_SIZE
+#define SCHNORR_VERIFY_BATCH_SIZE 32
+#endif
+
+// use constant time safegcd inverse method (overrides USE_INVERSE_FAST)
+#ifndef USE_INVERSE_SAFEGCD
+#define USE_INVERSE_SAFEGCD 1
+#endif
+
+// use fast (but not constant time) inverse method
 #ifndef USE_INVERSE_FAST
 #define USE_INVERSE_FAST 1
 #endif
 
+// use 64-bit limbs and 128-bit products inside bn_multiply
+// (only available on 64-bit hosts, the MCU build keeps 30-bit limbs)
+#ifndef USE_BN_64BIT_LIMBS
+#if defined(__SIZEOF_INT128__)
+#define USE_BN_64BIT_LIMBS 1
+#else
+#define USE_BN_64BIT_LIMBS 0
+#endif
+#endif
+
+// use four lane AVX2 field arithmetic for batched scalar multiplication
+// (x86-64 hosts only, the AVX2 code is selected at runtime)
+#ifndef USE_BN_X4
+#if defined(__x86_64__) && defined(__GNUC__)
+#define USE_BN_X4 1
+#else
+#define USE_BN_X4 0
+#endif
+#endif
+
+// use packed 32 bit words and UMAAL inside bn_multiply
+// (ARMv7E-M, e.g. the Cortex-M4 boards; elsewhere UMAAL is emulated in C)
+// Off for now: neither make -C tools test-arm nor bench-arm has been run.
+// Turn it on under __ARM_ARCH_7EM__ once both pass there and bench-arm
+// shows bn_multiply getting faster.
+#ifndef USE_BN_UMAAL
+#define USE_BN_UMAAL 0
+#endif
+
 // support for printing bignum256 structures via printf
 #ifndef USE_BN_PRINT
 #define USE_BN_PRINT 0
 #endif
 
-// use deterministic signatures
+// use deterministic signatures.  ecdsa_sign_digest has no other source
+// of nonces: random32() is a test generator, not fit for signing.
 #ifndef USE_RFC6979
 #define USE_RFC6979 1
 #endif
 
+#if !USE_RFC6979
+#error "ecdsa_sign_digest requires USE_RFC6979"
+#endif
+
 // implement BIP32 caching
 #ifndef USE_BIP32_CACHE
 #define USE_BIP32_CACHE 1
@@ -91,6 +187,17 @@
 #define USE_KECCAK 1
 #endif
 
+// storage class of the random32() state in rand.c.  Hosts keep one
+// generator per thread, so that threads calling into the library do not
+// share it.  Bare metal builds have a single thread and no TLS.
+#ifndef RAND_THREAD_LOCAL
+#if defined(__linux__) || defined(__APPLE__)
+#define RAND_THREAD_LOCAL _Thread_local
+#else
+#define RAND_THREAD_LOCAL
+#endif
+#endif
+
 // add way how to mark confidential data
 #ifndef CONFIDENTIAL
 #define CONFIDENTIAL
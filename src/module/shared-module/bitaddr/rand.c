@@ -22,6 +22,7 @@
  */
 
 #include "rand.h"
+#include "options.h"
 
 #ifndef RAND_PLATFORM_INDEPENDENT
 
@@ -34,23 +35,54 @@
 // own secure code. There is also a possibility to replace the random_buffer()
 // function as it is defined as a weak symbol.
 
-static uint32_t seed = 0;
+static RAND_THREAD_LOCAL random_ctx default_ctx = {0};
+static RAND_THREAD_LOCAL int default_ctx_seeded = 0;
 
-void random_reseed(const uint32_t value) { seed = value; }
+// the last seed given to random_reseed() or init_random32() in any thread
+// and the number of default contexts seeded from it so far
+static uint32_t base_seed = 0;
+static uint32_t base_seed_uses = 0;
 
-
-void init_random32(unsigned char* entropy)
-{
-	seed = (uint32_t) *entropy;
+void random_ctx_reseed(random_ctx *ctx, const uint32_t value) {
+  ctx->seed = value;
 }
 
-uint32_t random32(void) {
+uint32_t random32_ctx(random_ctx *ctx) {
   // Linear congruential generator from Numerical Recipes
   // https://en.wikipedia.org/wiki/Linear_congruential_generator
-  seed = 1664525 * seed + 1013904223;
-  return seed;
+  ctx->seed = 1664525 * ctx->seed + 1013904223;
+  return ctx->seed;
+}
+
+// A thread that never reseeded its default ctx starts from the last seed
+// of any thread, offset by a count, so that no two threads share their
+// sequence.  The first thread gets the seed itself.
+random_ctx *random_default_ctx(void) {
+  if (!default_ctx_seeded) {
+    uint32_t n = __atomic_fetch_add(&base_seed_uses, 1, __ATOMIC_RELAXED);
+    random_ctx_reseed(&default_ctx,
+                      __atomic_load_n(&base_seed, __ATOMIC_RELAXED) ^
+                          (n * 0x9e3779b9));
+    default_ctx_seeded = 1;
+  }
+  return &default_ctx;
+}
+
+void random_reseed(const uint32_t value) {
+  __atomic_store_n(&base_seed, value, __ATOMIC_RELAXED);
+  __atomic_store_n(&base_seed_uses, 1, __ATOMIC_RELAXED);
+  random_ctx_reseed(&default_ctx, value);
+  default_ctx_seeded = 1;
 }
 
+
+void init_random32(unsigned char* entropy)
+{
+	random_reseed((uint32_t) *entropy);
+}
+
+uint32_t random32(void) { return random32_ctx(random_default_ctx()); }
+
 #endif /* RAND_PLATFORM_INDEPENDENT */
 
 //
@@ -27,6 +27,19 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+// state of the random32 generator
+typedef struct {
+  uint32_t seed;
+} random_ctx;
+
+void random_ctx_reseed(random_ctx *ctx, const uint32_t value);
+uint32_t random32_ctx(random_ctx *ctx);
+
+// the context behind random32(), one per thread on hosts
+// (see RAND_THREAD_LOCAL in options.h).  Each thread's context is seeded
+// differently on first use, see rand.c.
+random_ctx *random_default_ctx(void);
+
 void init_random32(unsigned char* entropy);
 void random_reseed(const uint32_t value);
 uint32_t random32(void);
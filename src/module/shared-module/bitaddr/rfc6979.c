@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2013-2014 Tomas Dzetkulic
+ * Copyright (c) 2013-2014 Pavol Rusnak
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "memzero.h"
+#include "rfc6979.h"
+
+#define SHA256_WORDS (SHA256_DIGEST_LENGTH / sizeof(uint32_t))
+#define SHA256_BLOCK_WORDS (SHA256_BLOCK_LENGTH / sizeof(uint32_t))
+
+// inner and outer midstates of the 32 byte HMAC key given as words
+static void rfc6979_prepare_key(const uint32_t *key, uint32_t *idig,
+                                uint32_t *odig) {
+  uint32_t pad[SHA256_BLOCK_WORDS];
+  size_t i;
+
+  for (i = 0; i < SHA256_BLOCK_WORDS; i++) {
+    pad[i] = (i < SHA256_WORDS ? key[i] : 0) ^ 0x36363636;
+  }
+  sha256_Transform(sha256_initial_hash_value, pad, idig);
+  for (i = 0; i < SHA256_BLOCK_WORDS; i++) {
+    pad[i] ^= 0x36363636 ^ 0x5c5c5c5c;
+  }
+  sha256_Transform(sha256_initial_hash_value, pad, odig);
+  memzero(pad, sizeof(pad));
+}
+
+// completes an HMAC: out = SHA-256(opad(K) || h) for the inner hash h
+static void rfc6979_outer(const uint32_t *odig, const uint8_t *h,
+                          uint32_t *out) {
+  uint32_t block[SHA256_BLOCK_WORDS] = {0};
+  size_t i;
+
+  for (i = 0; i < SHA256_WORDS; i++) {
+    block[i] = ((uint32_t)h[4 * i] << 24) | ((uint32_t)h[4 * i + 1] << 16) |
+               ((uint32_t)h[4 * i + 2] << 8) | h[4 * i + 3];
+  }
+  block[SHA256_WORDS] = 0x80000000;
+  block[SHA256_BLOCK_WORDS - 1] =
+      (SHA256_BLOCK_LENGTH + SHA256_DIGEST_LENGTH) * 8;
+  sha256_Transform(odig, block, out);
+  memzero(block, sizeof(block));
+}
+
+static void rfc6979_write_v(const rfc6979_state *state, uint8_t *out) {
+  size_t i;
+  for (i = 0; i < SHA256_WORDS; i++) {
+    out[4 * i] = state->v[i] >> 24;
+    out[4 * i + 1] = state->v[i] >> 16;
+    out[4 * i + 2] = state->v[i] >> 8;
+    out[4 * i + 3] = state->v[i];
+  }
+}
+
+// V = HMAC_K(V), the padding in v[8..15] fits both the inner and the
+// outer hash.
+static void rfc6979_update_v(rfc6979_state *state) {
+  sha256_Transform(state->idig, state->v, state->v);
+  sha256_Transform(state->odig, state->v, state->v);
+}
+
+// K = HMAC_K(V || domain || data)
+static void rfc6979_update_k(rfc6979_state *state, uint8_t domain,
+                             const uint8_t *data, size_t len) {
+  SHA256_CTX ctx;
+  uint8_t buf[SHA256_DIGEST_LENGTH];
+  uint32_t k[SHA256_WORDS];
+
+  memcpy(ctx.state, state->idig, sizeof(ctx.state));
+  ctx.bitcount = SHA256_BLOCK_LENGTH * 8;
+  rfc6979_write_v(state, buf);
+  sha256_Update(&ctx, buf, sizeof(buf));
+  sha256_Update(&ctx, &domain, 1);
+  sha256_Update(&ctx, data, len);
+  sha256_Final(&ctx, buf);
+  rfc6979_outer(state->odig, buf, k);
+  rfc6979_prepare_key(k, state->idig, state->odig);
+  memzero(buf, sizeof(buf));
+  memzero(k, sizeof(k));
+}
+
+void init_rfc6979_key(const uint8_t *priv_key, rfc6979_key *key) {
+  static const uint32_t zero[SHA256_WORDS] = {0};
+  uint8_t buf[SHA256_BLOCK_LENGTH];
+  SHA256_CTX ctx;
+
+  // K0 = 0x00 ... 0x00, V0 = 0x01 ... 0x01.  The first HMAC of step d
+  // is over V0 || 0x00 || x || h1, its first block after ipad(K0) only
+  // depends on x.
+  memcpy(key->x, priv_key, 32);
+  rfc6979_prepare_key(zero, ctx.state, key->odig);
+  ctx.bitcount = SHA256_BLOCK_LENGTH * 8;
+  memset(buf, 0x01, SHA256_DIGEST_LENGTH);
+  buf[SHA256_DIGEST_LENGTH] = 0x00;
+  memcpy(buf + SHA256_DIGEST_LENGTH + 1, priv_key, 31);
+  sha256_Update(&ctx, buf, sizeof(buf));
+  memcpy(key->idig, ctx.state, sizeof(key->idig));
+  memzero(buf, sizeof(buf));
+  memzero(&ctx, sizeof(ctx));
+}
+
+void init_rfc6979(const rfc6979_key *key, const uint8_t *hash,
+                  const ecdsa_curve *curve, rfc6979_state *state) {
+  uint8_t bx[2 * 32];
+  uint8_t buf[SHA256_DIGEST_LENGTH];
+  uint32_t k[SHA256_WORDS];
+  bignum256 z;
+  SHA256_CTX ctx;
+  size_t i;
+
+  // bx = x || bits2octets(hash)
+  memcpy(bx, key->x, 32);
+  bn_read_be(hash, &z);
+  // z < 2^256 < 2 * order
+  bn_mod(&z, &curve->order);
+  bn_write_be(&z, bx + 32);
+
+  // step d: K = HMAC_K0(V0 || 0x00 || x || h1), resumed after x[0..30]
+  memcpy(ctx.state, key->idig, sizeof(ctx.state));
+  ctx.bitcount = 2 * SHA256_BLOCK_LENGTH * 8;
+  sha256_Update(&ctx, bx + 31, 33);
+  sha256_Final(&ctx, buf);
+  rfc6979_outer(key->odig, buf, k);
+  rfc6979_prepare_key(k, state->idig, state->odig);
+
+  // step e: V = HMAC_K(V0)
+  for (i = 0; i < SHA256_WORDS; i++) {
+    state->v[i] = 0x01010101;
+  }
+  state->v[SHA256_WORDS] = 0x80000000;
+  for (i = SHA256_WORDS + 1; i < SHA256_BLOCK_WORDS - 1; i++) {
+    state->v[i] = 0;
+  }
+  state->v[SHA256_BLOCK_WORDS - 1] =
+      (SHA256_BLOCK_LENGTH + SHA256_DIGEST_LENGTH) * 8;
+  rfc6979_update_v(state);
+
+  // steps f and g: K = HMAC_K(V || 0x01 || x || h1), V = HMAC_K(V)
+  rfc6979_update_k(state, 0x01, bx, sizeof(bx));
+  rfc6979_update_v(state);
+  state->retry = 0;
+
+  memzero(bx, sizeof(bx));
+  memzero(buf, sizeof(buf));
+  memzero(k, sizeof(k));
+  memzero(&z, sizeof(z));
+  memzero(&ctx, sizeof(ctx));
+}
+
+void generate_k_rfc6979(bignum256 *k, rfc6979_state *state) {
+  uint8_t buf[SHA256_DIGEST_LENGTH];
+
+  // the update of step h.3 is only needed when the previous nonce was
+  // rejected, so it is done here instead of after every nonce.
+  if (state->retry) {
+    rfc6979_update_k(state, 0x00, NULL, 0);
+    rfc6979_update_v(state);
+  }
+  rfc6979_update_v(state);
+  state->retry = 1;
+  rfc6979_write_v(state, buf);
+  bn_read_be(buf, k);
+  memzero(buf, sizeof(buf));
+}
@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2013-2014 Tomas Dzetkulic
+ * Copyright (c) 2013-2014 Pavol Rusnak
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __RFC6979_H__
+#define __RFC6979_H__
+
+#include <stdint.h>
+#include "bignum.h"
+#include "ecdsa.h"
+#include "sha2.h"
+
+// Deterministic nonces for ecdsa signatures, RFC 6979 with HMAC-SHA256.
+// HMAC keys are kept as their inner and outer SHA-256 midstates, so each
+// HMAC of a 32 byte message costs two compressions.
+
+// HMAC_DRBG state: midstates of the HMAC key K and the value V
+typedef struct {
+  uint32_t idig[SHA256_DIGEST_LENGTH / sizeof(uint32_t)];
+  uint32_t odig[SHA256_DIGEST_LENGTH / sizeof(uint32_t)];
+  // V followed by the SHA-256 padding of a 32 byte message after a key block
+  uint32_t v[SHA256_BLOCK_LENGTH / sizeof(uint32_t)];
+  int retry;  // K and V must be updated before the next nonce
+} rfc6979_state;
+
+// the part of the nonce generation that only depends on the private key.
+// Computed once, it is reused for every message signed with the key.
+// Holds secret data, memzero it when done.
+typedef struct rfc6979_key {
+  uint8_t x[32];  // the private key
+  // inner midstate of the first HMAC, over ipad(0) || V0 || 0x00 || x[0..30]
+  uint32_t idig[SHA256_DIGEST_LENGTH / sizeof(uint32_t)];
+  // outer midstate of the first HMAC, over opad(0)
+  uint32_t odig[SHA256_DIGEST_LENGTH / sizeof(uint32_t)];
+} rfc6979_key;
+
+void init_rfc6979_key(const uint8_t *priv_key, rfc6979_key *key);
+// starts the nonce generation for the 32 byte digest hash
+void init_rfc6979(const rfc6979_key *key, const uint8_t *hash,
+                  const ecdsa_curve *curve, rfc6979_state *state);
+// the next candidate nonce, the caller must check 0 < k < order
+void generate_k_rfc6979(bignum256 *k, rfc6979_state *state);
+
+#endif
@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2013-2014 Tomas Dzetkulic
+ * Copyright (c) 2013-2014 Pavol Rusnak
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "memzero.h"
+#include "scalar.h"
+#include "secp256k1.h"
+
+// c = 2^256 - n, a 129 bit number, in base 2^30.
+// Since 2^256 = c (mod n) the upper half of a number can be folded
+// onto the lower half by multiplying it with c.
+static const uint32_t scalar_c[5] = {0x2fc9bebf, 0x00b685cc, 0x0b75fc44,
+                                     0x1448c654, 0x00000145};
+
+// constants of the secp256k1 endomorphism, see scalar_split_lambda.
+// lambda is a cube root of unity modulo n, b1 and b2 come from a short
+// basis of the lattice {(a, b) : a + b * lambda = 0 mod n} and
+// g1 = round(2^384 * b2 / n), g2 = round(2^384 * -b1 / n).
+static const bignum256 scalar_lambda = {
+    {0x1b23bd72, 0x3c0a59f0, 0x0816678d, 0x0b88ba88, 0x12645a12, 0x18700a20,
+     0x030e0a52, 0x2b533017, 0x00005363}};
+static const bignum256 scalar_minus_b1 = {
+    {0x0abfe4c3, 0x3d51fea4, 0x10e88286, 0x10dfb580, 0x000000e4, 0x00000000,
+     0x00000000, 0x00000000, 0x00000000}};
+static const bignum256 scalar_minus_b2 = {
+    {0x3db1562c, 0x1d9736a0, 0x374346dd, 0x0a02b141, 0x3ffffe8a, 0x3fffffff,
+     0x3fffffff, 0x3fffffff, 0x0000ffff}};
+static const bignum256 scalar_g1 = {
+    {0x05dbb031, 0x224c8269, 0x1e8ca7fe, 0x2aa2851c, 0x04eb153d, 0x3243924a,
+     0x06bcde86, 0x348869f5, 0x00003086}};
+static const bignum256 scalar_g2 = {
+    {0x0ac47f71, 0x15c6d2ba, 0x1f506c61, 0x04822b27, 0x3fe4c422, 0x11fea42a,
+     0x288286f5, 0x1fb58043, 0x0000e443}};
+
+int scalar_is_valid(const bignum256 *a) {
+  return (!bn_is_zero(a)) & bn_is_less(a, &secp256k1.order);
+}
+
+int scalar_read_be(const uint8_t *in, bignum256 *r) {
+  int valid;
+  bn_read_be(in, r);
+  valid = bn_is_less(r, &secp256k1.order);
+  // r < 2^256 < 2 * n
+  bn_mod(r, &secp256k1.order);
+  return valid;
+}
+
+void scalar_add(bignum256 *r, const bignum256 *a, const bignum256 *b) {
+  *r = *a;
+  bn_add(r, b);
+  // r < 2 * n
+  bn_mod(r, &secp256k1.order);
+}
+
+void scalar_negate(bignum256 *r, const bignum256 *a) {
+  // n - a, which is n for a == 0
+  bn_subtract(&secp256k1.order, a, r);
+  bn_mod(r, &secp256k1.order);
+}
+
+// auxiliary function for scalar_mul.
+// computes out = (in % 2^256) + (in >> 256) * c
+// in has inlen normalized limbs, out gets outlen normalized limbs.
+static void scalar_fold(const uint32_t *in, size_t inlen, uint32_t *out,
+                        size_t outlen) {
+  size_t i, j;
+  uint32_t hi[10];
+  uint64_t temp = 0;
+  const size_t hilen = inlen - 8;
+
+  assert(inlen > 8 && hilen <= 10);
+  // hi = in >> 256
+  for (i = 0; i < hilen; i++) {
+    hi[i] = in[i + 8] >> 16;
+    if (i + 9 < inlen) {
+      hi[i] |= (in[i + 9] << 14) & 0x3FFFFFFF;
+    }
+  }
+  for (i = 0; i < outlen; i++) {
+    if (i < 8) {
+      temp += in[i];
+    } else if (i == 8) {
+      temp += in[8] & 0xFFFF;
+    }
+    // at most five 60 bit products per limb, no overflow
+    for (j = (i < 5 ? 0 : i - 4); j < hilen && j <= i; j++) {
+      temp += (uint64_t)hi[j] * scalar_c[i - j];
+    }
+    out[i] = temp & 0x3FFFFFFF;
+    temp >>= 30;
+  }
+  assert(temp == 0);
+  memzero(hi, sizeof(hi));
+}
+
+void scalar_mul(bignum256 *r, const bignum256 *a, const bignum256 *b) {
+  uint32_t res[18] = {0}, t1[13], t2[9];
+
+  bn_multiply_long(a, b, res);
+  // res < 2^512, t1 < 2^256 + 2^385
+  scalar_fold(res, 18, t1, 13);
+  // t2 < 2^256 + 2^259
+  scalar_fold(t1, 13, t2, 9);
+  // r < 2^256 + 2^133 < 2 * n
+  scalar_fold(t2, 9, r->val, 9);
+  bn_mod(r, &secp256k1.order);
+  memzero(res, sizeof(res));
+  memzero(t1, sizeof(t1));
+  memzero(t2, sizeof(t2));
+}
+
+void scalar_inverse(bignum256 *r, const bignum256 *a) {
+  *r = *a;
+  bn_inverse(r, &secp256k1.order);
+  bn_mod(r, &secp256k1.order);
+}
+
+// r = round(a * g / 2^384) for normalized a and g, a result below 2^129.
+static void scalar_mul_shift_384(bignum256 *r, const bignum256 *a,
+                                 const bignum256 *g) {
+  uint32_t res[18];
+  int i;
+
+  bn_multiply_long(a, g, res);
+  // bit 384 is bit 24 of limb 12
+  for (i = 0; i < 5; i++) {
+    r->val[i] = (res[12 + i] >> 24) | ((res[13 + i] << 6) & 0x3FFFFFFF);
+  }
+  for (; i < 9; i++) {
+    r->val[i] = 0;
+  }
+  // round with bit 383
+  bn_addi(r, (res[12] >> 23) & 1);
+  memzero(res, sizeof(res));
+}
+
+void scalar_split_lambda(bignum256 *r1, bignum256 *r2, const bignum256 *k) {
+  bignum256 c1, c2;
+
+  // c1 = round(k * b2 / n), c2 = round(k * -b1 / n)
+  scalar_mul_shift_384(&c1, k, &scalar_g1);
+  scalar_mul_shift_384(&c2, k, &scalar_g2);
+  // r2 = -(c1 * b1 + c2 * b2)
+  scalar_mul(&c1, &c1, &scalar_minus_b1);
+  scalar_mul(&c2, &c2, &scalar_minus_b2);
+  scalar_add(r2, &c1, &c2);
+  // r1 = k - r2 * lambda
+  scalar_mul(&c1, r2, &scalar_lambda);
+  scalar_negate(&c1, &c1);
+  scalar_add(r1, k, &c1);
+  memzero(&c1, sizeof(c1));
+  memzero(&c2, sizeof(c2));
+}
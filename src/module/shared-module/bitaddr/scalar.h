@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2013-2014 Tomas Dzetkulic
+ * Copyright (c) 2013-2014 Pavol Rusnak
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __SCALAR_H__
+#define __SCALAR_H__
+
+#include <stdint.h>
+#include "bignum.h"
+
+// Arithmetic modulo the order n of the secp256k1 group.
+// Scalars are bignum256 numbers fully reduced modulo n, i.e. 0 <= a < n.
+// All functions are constant time.
+
+// returns 1 iff 0 < a < n
+int scalar_is_valid(const bignum256 *a);
+
+// reads a 32 byte big endian number and reduces it modulo n.
+// returns 1 iff the number was already smaller than n.
+int scalar_read_be(const uint8_t *in, bignum256 *r);
+
+// r = a + b mod n
+void scalar_add(bignum256 *r, const bignum256 *a, const bignum256 *b);
+
+// r = -a mod n
+void scalar_negate(bignum256 *r, const bignum256 *a);
+
+// r = a * b mod n
+void scalar_mul(bignum256 *r, const bignum256 *a, const bignum256 *b);
+
+// r = a^-1 mod n, a must not be zero
+void scalar_inverse(bignum256 *r, const bignum256 *a);
+
+// splits k into k = r1 + r2 * lambda mod n, where lambda is the cube
+// root of unity with lambda * (x, y) = (beta * x, y) on the curve.
+// r1 and r2 are short: each is below 2^128 or above n - 2^128, i.e.,
+// a negative number of at most 128 bits.
+void scalar_split_lambda(bignum256 *r1, bignum256 *r2, const bignum256 *k);
+
+#endif
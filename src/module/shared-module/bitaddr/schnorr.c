@@ -0,0 +1,279 @@
+/**
+ * Copyright (c) 2013-2014 Tomas Dzetkulic
+ * Copyright (c) 2013-2014 Pavol Rusnak
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "memzero.h"
+#include "scalar.h"
+#include "schnorr.h"
+#include "secp256k1.h"
+#include "sha2.h"
+
+// SHA-256 midstates after the 64 byte prefix sha256(tag) || sha256(tag)
+// of the BIP340 tagged hashes, so a tagged hash only compresses its data.
+// BIP0340/challenge
+static const uint32_t schnorr_challenge_midstate[8] = {
+    0x9cecba11, 0x23925381, 0x11679112, 0xd1627e0f,
+    0x97c87550, 0x003cc765, 0x90f61164, 0x33e9b66a};
+// TapTweak
+static const uint32_t schnorr_taptweak_midstate[8] = {
+    0xd129a2f3, 0x701c655d, 0x6583b6c3, 0xb9419727,
+    0x95f4e232, 0x94fd54f4, 0xa2ae8d85, 0x47ca590b};
+
+// starts a tagged hash at the midstate of its tag
+static void schnorr_tagged_hash_init(SHA256_CTX *ctx,
+                                     const uint32_t *midstate) {
+  memcpy(ctx->state, midstate, sizeof(ctx->state));
+  ctx->bitcount = SHA256_BLOCK_LENGTH * 8;
+}
+
+// the point with x coordinate x and even y, returns 0 if there is none
+static int schnorr_lift_x(const uint8_t *x, curve_point *p) {
+  bn_read_be(x, &p->x);
+  if (!bn_is_less(&p->x, &secp256k1.prime)) {
+    return 0;
+  }
+  uncompress_coords(&secp256k1, 0, &p->x, &p->y);
+  return ecdsa_validate_pubkey(&secp256k1, p);
+}
+
+// e = hash_BIP0340/challenge(r || pub_key || msg) mod n
+static void schnorr_challenge(const uint8_t *r, const uint8_t *pub_key,
+                              const uint8_t *msg, bignum256 *e) {
+  uint8_t hash[SHA256_DIGEST_LENGTH];
+  SHA256_CTX ctx;
+
+  schnorr_tagged_hash_init(&ctx, schnorr_challenge_midstate);
+  sha256_Update(&ctx, r, 32);
+  sha256_Update(&ctx, pub_key, 32);
+  sha256_Update(&ctx, msg, 32);
+  sha256_Final(&ctx, hash);
+  scalar_read_be(hash, e);
+}
+
+// output = x(p + hash_TapTweak(x(p)) * G) for p with an even y
+static int schnorr_tweak_point(const curve_point *p, uint8_t *output_key) {
+  uint8_t hash[SHA256_DIGEST_LENGTH];
+  curve_point q;
+  bignum256 t;
+  SHA256_CTX ctx;
+
+  bn_write_be(&p->x, hash);
+  schnorr_tagged_hash_init(&ctx, schnorr_taptweak_midstate);
+  sha256_Update(&ctx, hash, sizeof(hash));
+  sha256_Final(&ctx, hash);
+  if (!scalar_read_be(hash, &t)) {
+    return 0;
+  }
+
+  // q = p + t * G, infinity if t * G = -p
+  scalar_multiply(&secp256k1, &t, &q);
+  point_add(&secp256k1, p, &q);
+  if (point_is_infinity(&q)) {
+    return 0;
+  }
+  bn_write_be(&q.x, output_key);
+  return 1;
+}
+
+void schnorr_get_public_key(const uint8_t *priv_key, uint8_t *pub_key) {
+  curve_point p;
+  bignum256 k;
+
+  bn_read_be(priv_key, &k);
+  scalar_multiply(&secp256k1, &k, &p);
+  bn_write_be(&p.x, pub_key);
+  memzero(&k, sizeof(k));
+  memzero(&p, sizeof(p));
+}
+
+int schnorr_tweak_public_key(const uint8_t *pub_key, uint8_t *output_key) {
+  curve_point p;
+
+  if (!schnorr_lift_x(pub_key, &p)) {
+    return 0;
+  }
+  return schnorr_tweak_point(&p, output_key);
+}
+
+int schnorr_get_tweaked_public_key(const uint8_t *priv_key,
+                                   uint8_t *output_key) {
+  curve_point p;
+  bignum256 k;
+  int result;
+
+  bn_read_be(priv_key, &k);
+  if (bn_is_zero(&k) || !bn_is_less(&k, &secp256k1.order)) {
+    memzero(&k, sizeof(k));
+    return 0;
+  }
+  scalar_multiply(&secp256k1, &k, &p);
+  // the x-only key stands for the point with even y
+  if (bn_is_odd(&p.y)) {
+    bn_subtract(&secp256k1.prime, &p.y, &p.y);
+  }
+  result = schnorr_tweak_point(&p, output_key);
+  memzero(&k, sizeof(k));
+  memzero(&p, sizeof(p));
+  return result;
+}
+
+int schnorr_verify_digest(const uint8_t *pub_key, const uint8_t *sig,
+                          const uint8_t *msg) {
+  curve_point pub, res;
+  bignum256 r, s, e;
+
+  if (!schnorr_lift_x(pub_key, &pub)) {
+    return 1;
+  }
+
+  bn_read_be(sig, &r);
+  bn_read_be(sig + 32, &s);
+  if (!bn_is_less(&r, &secp256k1.prime) ||
+      !bn_is_less(&s, &secp256k1.order)) {
+    return 2;
+  }
+
+  // res = s * G - e * pub
+  schnorr_challenge(sig, pub_key, msg, &e);
+  scalar_negate(&e, &e);
+  point_multiply_dual(&secp256k1, &s, &e, &pub, &res);
+  if (point_is_infinity(&res)) {
+    return 3;
+  }
+
+  if (bn_is_odd(&res.y) || !bn_is_equal(&res.x, &r)) {
+    return 4;
+  }
+  return 0;
+}
+
+// appends the term k * p to a multi multiplication and returns the number
+// of terms added.  With the endomorphism k is split into two halves of at
+// most 128 bits, which halves the windows of point_multiply_multi.
+static size_t schnorr_add_term(const bignum256 *k, const curve_point *p,
+                               bignum256 *ks, curve_point *ps) {
+#if USE_SECP256K1_GLV
+  int j;
+
+  scalar_split_lambda(&ks[0], &ks[1], k);
+  ps[0] = *p;
+  point_lambda(p, &ps[1]);
+  for (j = 0; j < 2; j++) {
+    // use |k_j| and negate the point instead
+    if (bn_is_less(&secp256k1.order_half, &ks[j])) {
+      scalar_negate(&ks[j], &ks[j]);
+      bn_subtract(&secp256k1.prime, &ps[j].y, &ps[j].y);
+    }
+  }
+  return 2;
+#else
+  ks[0] = *k;
+  ps[0] = *p;
+  return 1;
+#endif
+}
+
+// checks sum a_i (s_i G - R_i - e_i P_i) = 0 for up to
+// SCHNORR_VERIFY_BATCH_SIZE signatures, where a_0 = 1 and the other
+// weights are 128 bit numbers derived from a hash of all inputs.  Every
+// invalid signature makes the sum nonzero, unless the weights hit one of
+// at most 2^-128 of their values.
+static int schnorr_verify_chunk(const uint8_t *pub_keys, const uint8_t *sigs,
+                                const uint8_t *msgs, size_t n) {
+  // R_i with the weight a_i, P_i and G with up to two terms each
+  bignum256 k[3 * SCHNORR_VERIFY_BATCH_SIZE + 2];
+  curve_point p[3 * SCHNORR_VERIFY_BATCH_SIZE + 2], pub, res;
+  bignum256 a, e, s, sum;
+  uint8_t seed[SHA256_DIGEST_LENGTH], buf[SHA256_DIGEST_LENGTH + 4];
+  SHA256_CTX ctx;
+  size_t i, t = 0;
+
+  sha256_Init(&ctx);
+  for (i = 0; i < n; i++) {
+    sha256_Update(&ctx, pub_keys + 32 * i, 32);
+    sha256_Update(&ctx, sigs + 64 * i, 64);
+    sha256_Update(&ctx, msgs + 32 * i, 32);
+  }
+  sha256_Final(&ctx, seed);
+
+  bn_zero(&sum);
+  for (i = 0; i < n; i++) {
+    if (!schnorr_lift_x(pub_keys + 32 * i, &pub)) {
+      return 1;
+    }
+    bn_read_be(sigs + 64 * i + 32, &s);
+    if (!bn_is_less(&s, &secp256k1.order) ||
+        !schnorr_lift_x(sigs + 64 * i, &p[t])) {
+      return 2;
+    }
+
+    if (i == 0) {
+      bn_one(&a);
+    } else {
+      // a_i = the first 128 bits of sha256(seed || i)
+      memcpy(buf, seed, sizeof(seed));
+      buf[32] = i >> 24;
+      buf[33] = i >> 16;
+      buf[34] = i >> 8;
+      buf[35] = i;
+      sha256_Raw(buf, sizeof(buf), buf);
+      memset(buf + 16, 0, 16);
+      bn_read_le(buf, &a);
+    }
+
+    // a_i R_i
+    k[t++] = a;
+    // a_i e_i P_i
+    schnorr_challenge(sigs + 64 * i, pub_keys + 32 * i, msgs + 32 * i, &e);
+    scalar_mul(&e, &e, &a);
+    t += schnorr_add_term(&e, &pub, &k[t], &p[t]);
+    // sum = sum a_i s_i
+    scalar_mul(&s, &s, &a);
+    scalar_add(&sum, &sum, &s);
+  }
+  // - sum G
+  scalar_negate(&sum, &sum);
+  t += schnorr_add_term(&sum, &secp256k1.G, &k[t], &p[t]);
+
+  point_multiply_multi(&secp256k1, k, p, t, &res);
+  return point_is_infinity(&res) ? 0 : 4;
+}
+
+int schnorr_verify_batch(const uint8_t *pub_keys, const uint8_t *sigs,
+                         const uint8_t *msgs, size_t n) {
+  size_t i, m;
+  int result;
+
+  for (i = 0; i < n; i += m) {
+    m = n - i < SCHNORR_VERIFY_BATCH_SIZE ? n - i : SCHNORR_VERIFY_BATCH_SIZE;
+    result = schnorr_verify_chunk(pub_keys + 32 * i, sigs + 64 * i,
+                                  msgs + 32 * i, m);
+    if (result != 0) {
+      return result;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2013-2014 Tomas Dzetkulic
+ * Copyright (c) 2013-2014 Pavol Rusnak
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __SCHNORR_H__
+#define __SCHNORR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// BIP340 Schnorr signatures over secp256k1 with 32 byte x-only public
+// keys and 64 byte signatures r || s.  Messages are 32 bytes.
+
+// the x-only public key of priv_key, the x coordinate of priv_key * G.
+// priv_key must be below the order of G.
+void schnorr_get_public_key(const uint8_t *priv_key, uint8_t *pub_key);
+
+// the BIP341 output key of a key path only taproot output with the
+// internal x-only key pub_key: x(P + hash_TapTweak(x(P)) * G) where P is
+// pub_key with an even y.  returns 0 if pub_key is not on the curve or
+// the tweak fails.
+int schnorr_tweak_public_key(const uint8_t *pub_key, uint8_t *output_key);
+
+// schnorr_tweak_public_key of the x-only public key of priv_key.  P is
+// computed from priv_key, so it saves the square root of lifting the key.
+// returns 0 if priv_key is zero or not below the order of G, or the tweak
+// fails.
+int schnorr_get_tweaked_public_key(const uint8_t *priv_key,
+                                   uint8_t *output_key);
+
+// returns 0 if the signature is valid
+int schnorr_verify_digest(const uint8_t *pub_key, const uint8_t *sig,
+                          const uint8_t *msg);
+
+// verifies n signatures with the public keys pub_keys[32 * i] and the
+// messages msgs[32 * i] at once.  returns 0 if all signatures are valid,
+// a nonzero result does not tell which one failed.
+// Every SCHNORR_VERIFY_BATCH_SIZE signatures are checked with a random
+// linear combination in one point_multiply_multi.
+int schnorr_verify_batch(const uint8_t *pub_keys, const uint8_t *sigs,
+                         const uint8_t *msgs, size_t n);
+
+#endif
@@ -51,7 +51,13 @@ const ecdsa_curve secp256k1 = {
     ,
     /* cp */
     {
+#if PRECOMPUTED_CP_WINDOW == 4
 #include "secp256k1.table"
+#elif defined(SECP256K1_CP_TABLE)
+#include SECP256K1_CP_TABLE
+#else
+#error "no secp256k1 table for PRECOMPUTED_CP_WINDOW, see tools/mktable.py"
+#endif
     }
 #endif
 };
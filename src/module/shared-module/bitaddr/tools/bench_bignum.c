@@ -0,0 +1,55 @@
+// This program times the field kernels bn_multiply and bn_square and a
+// public key derivation built on them.  It uses clock() only, so it also
+// runs on an emulated Cortex-M4 (make -C tools bench-arm), where the
+// times are only good for comparing builds with each other.
+//
+// Usage: bench_bignum [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "options.h"
+#include "rand.h"
+#include "secp256k1.h"
+
+static double us_per_op(clock_t start, int n) {
+  return (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / n;
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 200000;
+  bignum256 a, b;
+  uint8_t k[32], pub[65];
+  clock_t start;
+  int i;
+
+  random_reseed(1);
+  random_buffer(k, sizeof(k));
+  bn_read_be(k, &a);
+  bn_mod(&a, &secp256k1.prime);
+  b = a;
+
+  printf("USE_BN_UMAAL=%d USE_BN_64BIT_LIMBS=%d\n", USE_BN_UMAAL,
+         USE_BN_64BIT_LIMBS);
+  start = clock();
+  for (i = 0; i < n; i++) {
+    bn_multiply(&a, &b, &secp256k1.prime);
+  }
+  printf("bn_multiply   %10.3f us\n", us_per_op(start, n));
+  start = clock();
+  for (i = 0; i < n; i++) {
+    bn_square(&b, &secp256k1.prime);
+  }
+  printf("bn_square     %10.3f us\n", us_per_op(start, n));
+  start = clock();
+  for (i = 0; i < n / 1000 + 1; i++) {
+    k[31] = i;
+    ecdsa_get_public_key65(&secp256k1, k, pub);
+  }
+  printf("public key    %10.3f us\n", us_per_op(start, n / 1000 + 1));
+  // keep the results alive
+  return pub[0] != 4 || bn_is_zero(&b);
+}
@@ -0,0 +1,261 @@
+// This program measures the comb table lookups of scalar_multiply, the
+// cache misses they cause and what they cost.
+//
+// First it looks up random points in two tables of the size of the
+// runtime table, one of 72 byte curve_points as ecdsa.c stores them and
+// one of 64 byte points packed into one cache line each, in the order
+// scalar_multiply visits the rows.  The packed layout is kept as the
+// baseline a change back to it would have to beat on misses.  Then it times scalar_multiply itself with whichever
+// table this build selects (the Makefile builds it with curve->cp and
+// with the runtime table).  The runtime table is built on the heap, or
+// mapped from a mkcpfile.py file if one is given, hashing its points
+// unless checked is given.  For the runtime table it also prints whether
+// the kernel accepted the hugepage advice and how much of the process is
+// actually mapped with hugepages.
+//
+// L1 data cache and last level cache read misses are counted with
+// perf_event_open.  The kernel has no generic L2 event, on hosts where
+// the last level is L2 that is the one counted.  Without counters
+// (e.g. in a VM without a PMU) only times are printed.
+//
+// Usage: bench_comb [keys [table file [checked]]]
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "options.h"
+#include "rand.h"
+#include "secp256k1.h"
+
+#define WINDOW RUNTIME_CP_WINDOW
+#define ROWS ((256 + WINDOW - 1) / WINDOW)
+#define POINTS (1 << (WINDOW - 1))
+
+// x and y as 32 byte little endian numbers in one cache line
+typedef struct {
+  uint8_t x[32], y[32];
+} __attribute__((aligned(64))) packed_point;
+
+static int counters[2] = {-1, -1};
+
+static int open_counter(uint32_t type, uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void open_counters(void) {
+  const uint64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  counters[0] =
+      open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | read_miss);
+  counters[1] =
+      open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | read_miss);
+}
+
+static void start_counters(void) {
+  int i;
+  for (i = 0; i < 2; i++) {
+    if (counters[i] >= 0) {
+      ioctl(counters[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(counters[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+// returns the count of counter i, or -1 if it is not available
+static double stop_counter(int i) {
+  uint64_t count;
+  if (counters[i] < 0) return -1;
+  ioctl(counters[i], PERF_EVENT_IOC_DISABLE, 0);
+  if (read(counters[i], &count, sizeof(count)) != sizeof(count)) return -1;
+  return count;
+}
+
+static double now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static double start_time;
+
+static void start(void) {
+  start_counters();
+  start_time = now_ns();
+}
+
+// prints time and misses per operation for n operations
+static void report(const char *name, int n) {
+  double ns = now_ns() - start_time;
+  double l1 = stop_counter(0), ll = stop_counter(1);
+  printf("%-32s %9.1f ns", name, ns / n);
+  if (l1 >= 0) printf("  %7.2f L1D misses", l1 / n);
+  if (ll >= 0) printf("  %7.2f LLC misses", ll / n);
+  printf("\n");
+}
+
+// reads all limbs of p, as the point addition does
+static inline uint32_t touch(const curve_point *p) {
+  uint32_t sum = 0;
+  int j;
+  for (j = 0; j < 9; j++) sum += p->x.val[j] ^ p->y.val[j];
+  return sum;
+}
+
+// random table indexes, one per row and key
+static uint32_t *random_indexes(int keys) {
+  uint32_t *index = malloc((size_t)keys * ROWS * sizeof(uint32_t));
+  int i;
+  if (index == NULL) return NULL;
+  random_buffer((uint8_t *)index, (size_t)keys * ROWS * sizeof(uint32_t));
+  for (i = 0; i < keys * ROWS; i++) {
+    index[i] = (uint32_t)(i % ROWS) * POINTS + index[i] % POINTS;
+  }
+  return index;
+}
+
+static void bench_layouts(int keys) {
+  const size_t n = (size_t)ROWS * POINTS;
+  curve_point *plain = malloc(n * sizeof(curve_point)), p;
+  packed_point *packed;
+  uint32_t *index = random_indexes(keys);
+  uint32_t sum = 0;
+  size_t i;
+
+  if (plain == NULL || index == NULL ||
+      posix_memalign((void **)&packed, 64, n * sizeof(packed_point)) != 0) {
+    printf("not enough memory for a w = %d table\n", WINDOW);
+    exit(1);
+  }
+  // any contents will do, the points are only read
+  random_buffer((uint8_t *)packed, n * sizeof(packed_point));
+  for (i = 0; i < n; i++) {
+    bn_read_le(packed[i].x, &plain[i].x);
+    bn_read_le(packed[i].y, &plain[i].y);
+  }
+
+  printf("w = %d table lookups, %d keys of %d rows\n", WINDOW, keys, ROWS);
+  start();
+  for (i = 0; i < (size_t)keys * ROWS; i++) {
+    sum += touch(&plain[index[i]]);
+  }
+  report("  72 byte curve_point, in place", keys * ROWS);
+  start();
+  for (i = 0; i < (size_t)keys * ROWS; i++) {
+    p = plain[index[i]];
+    sum += touch(&p);
+  }
+  report("  72 byte curve_point, copied", keys * ROWS);
+  start();
+  for (i = 0; i < (size_t)keys * ROWS; i++) {
+    bn_read_le(packed[index[i]].x, &p.x);
+    bn_read_le(packed[index[i]].y, &p.y);
+    sum += touch(&p);
+  }
+  report("  64 byte packed, unpacked", keys * ROWS);
+  // keep the loads alive
+  if (sum == 0) printf("\n");
+  free(plain);
+  free(packed);
+  free(index);
+}
+
+#if USE_RUNTIME_CP
+// prints the hugepage advice result and the kB of hugepages mapped into
+// this process, anonymous (the heap table) and file backed (a table file)
+static void report_hugepages(void) {
+  FILE *f = fopen("/proc/self/smaps", "r");
+  char line[256];
+  long kb, anon = 0, file = 0;
+
+  printf("  hugepage advice %s",
+         scalar_multiply_runtime_hugepages() == 1 ? "accepted"
+                                                 : "refused or off");
+  if (f == NULL) {
+    printf(", no /proc/self/smaps\n");
+    return;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) anon += kb;
+    if (sscanf(line, "FilePmdMapped: %ld kB", &kb) == 1) file += kb;
+  }
+  fclose(f);
+  printf(", %ld kB anonymous and %ld kB file hugepages mapped\n", anon,
+         file);
+}
+#endif
+
+static void bench_scalar_multiply(int keys, const char *path, int checked) {
+  bignum256 *k = malloc(keys * sizeof(bignum256));
+  curve_point r;
+  uint8_t buf[32];
+  uint32_t sum = 0;
+  int i;
+
+  if (k == NULL) exit(1);
+  for (i = 0; i < keys; i++) {
+    random_buffer(buf, sizeof(buf));
+    bn_read_be(buf, &k[i]);
+    bn_mod(&k[i], &secp256k1.order);
+  }
+#if USE_RUNTIME_CP
+  // load or build the table before the clock starts
+  if (path != NULL) {
+    double t = now_ns();
+    if (!(checked ? scalar_multiply_runtime_load_checked(path)
+                  : scalar_multiply_runtime_load(path))) {
+      printf("cannot load %s\n", path);
+      exit(1);
+    }
+    printf("%s loaded in %.1f ms%s\n", path, (now_ns() - t) / 1e6,
+           checked ? " without hashing the points" : "");
+  } else if (!scalar_multiply_runtime_init()) {
+    printf("not enough memory for the runtime table\n");
+    exit(1);
+  }
+  printf("scalar_multiply, runtime table\n");
+  report_hugepages();
+#else
+  (void)path;
+  (void)checked;
+  printf("scalar_multiply, curve->cp w = %d\n", PRECOMPUTED_CP_WINDOW);
+#endif
+  start();
+  for (i = 0; i < keys; i++) {
+    scalar_multiply(&secp256k1, &k[i], &r);
+    sum += r.x.val[0];
+  }
+  report("  per key", keys);
+  if (sum == 0) printf("\n");
+  free(k);
+}
+
+int main(int argc, char **argv) {
+  int keys = argc > 1 ? atoi(argv[1]) : 20000;
+  const char *path = argc > 2 ? argv[2] : NULL;
+  int checked = argc > 3 && strcmp(argv[3], "checked") == 0;
+
+  random_reseed(1);
+  open_counters();
+  if (counters[0] < 0 && counters[1] < 0) {
+    printf("no cache miss counters, times only\n");
+  }
+  bench_layouts(keys * 10);
+  bench_scalar_multiply(keys, path, checked);
+  return 0;
+}
@@ -0,0 +1,76 @@
+// This program times bn_inverse modulo the secp256k1 prime and group
+// order.  The Makefile builds it once for every inversion method of
+// options.h, so the methods can be compared on the same inputs.  Every
+// inverse is checked, x * x^-1 must be 1.
+//
+// Usage: bench_inverse [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bignum.h"
+#include "options.h"
+#include "rand.h"
+#include "secp256k1.h"
+
+#if USE_INVERSE_SAFEGCD
+#define INVERSE_METHOD "safegcd"
+#elif USE_INVERSE_FAST
+#define INVERSE_METHOD "almost modular inverse"
+#else
+#define INVERSE_METHOD "Fermat exponentiation"
+#endif
+
+#define INPUTS 64
+
+static double now_us(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+// times n inversions modulo m, returns the number of wrong results
+static int bench(const char *name, const bignum256 *m, int n) {
+  bignum256 x[INPUTS], y, one;
+  uint8_t buf[32];
+  double start, elapsed;
+  int i, bad = 0;
+
+  bn_one(&one);
+  for (i = 0; i < INPUTS; i++) {
+    do {
+      random_buffer(buf, sizeof(buf));
+      bn_read_be(buf, &x[i]);
+      bn_mod(&x[i], m);
+    } while (bn_is_zero(&x[i]));
+  }
+
+  start = now_us();
+  for (i = 0; i < n; i++) {
+    y = x[i % INPUTS];
+    bn_inverse(&y, m);
+  }
+  elapsed = now_us() - start;
+
+  for (i = 0; i < INPUTS; i++) {
+    y = x[i];
+    bn_inverse(&y, m);
+    bn_multiply(&x[i], &y, m);
+    bn_mod(&y, m);
+    bad += !bn_is_equal(&y, &one);
+  }
+  printf("%-24s mod %-5s %8.2f us%s\n", INVERSE_METHOD, name, elapsed / n,
+         bad ? "  WRONG RESULTS" : "");
+  return bad;
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 20000;
+  int bad;
+
+  random_reseed(1);
+  bad = bench("p", &secp256k1.prime, n);
+  bad += bench("n", &secp256k1.order, n);
+  return bad != 0;
+}
@@ -0,0 +1,66 @@
+# This script builds a comb table file for secp256k1 that
+# scalar_multiply_runtime_load in ecdsa.c maps into memory
+#
+# The file starts with a 64 byte header, padded with zeros to 4096 bytes
+#   char     magic[8]     "CPTABLE\0"
+#   uint32   version      1
+#   uint32   window       window width w
+#   uint32   rows         ceil(256 / w)
+#   uint32   points       2^(w-1) points per row
+#   uint32   point_size   72, the size of a curve_point
+#   uint32   byte_order   0x01020304
+#   uint8    sha256[32]   hash of the points
+# followed by the points (2j+1) * 2^(w*i) * G, row by row, each as the
+# 9 x and 9 y limbs of a bignum256. All integers are little endian,
+# the byte order of the hosts this is meant for.  The points of every
+# w hash to a fixed digest, ecdsa.c has them compiled in and rejects any
+# other file.
+#
+# Usage: python3 mkcpfile.py <w> <file>
+#
+
+import hashlib
+import multiprocessing
+import struct
+import sys
+
+from mktable import GX, GY, limbs, point_add
+
+VERSION = 1
+OFFSET = 4096
+POINT = struct.Struct("<18I")
+
+# Build row i of the table for window width w
+def build_row(args):
+    w, i = args
+    base = (GX, GY)
+    for _ in range(w * i):
+        base = point_add(base, base)
+    double = point_add(base, base)
+    p = base
+    out = []
+    for j in range(1 << (w - 1)):
+        out.append(POINT.pack(*(limbs(p[0]) + limbs(p[1]))))
+        p = point_add(p, double)
+    return b"".join(out)
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: mkcpfile.py <w> <file>")
+    w = int(sys.argv[1])
+    if w < 2 or w > 16:
+        sys.exit("window width must be between 2 and 16")
+    rows = (256 + w - 1) // w
+    points = 1 << (w - 1)
+
+    with multiprocessing.Pool() as pool:
+        data = b"".join(pool.map(build_row, [(w, i) for i in range(rows)]))
+    header = b"CPTABLE\0" + struct.pack("<6I", VERSION, w, rows, points,
+                                        POINT.size, 0x01020304)
+    header += hashlib.sha256(data).digest()
+    with open(sys.argv[2], "wb") as f:
+        f.write(header.ljust(OFFSET, b"\0"))
+        f.write(data)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,68 @@
+# This script generates the precomputed comb table for secp256k1
+# that scalar_multiply uses when USE_PRECOMPUTED_CP is set
+#
+# The table for window width w has ceil(256 / w) rows of 2^(w-1) points
+# Row i holds (2j+1) * 2^(w*i) * G for j = 0 .. 2^(w-1) - 1
+# The output is included by secp256k1.c, see PRECOMPUTED_CP_WINDOW in options.h
+#
+# Usage: python3 mktable.py <w> > secp256k1_w<w>.table
+# python3 mktable.py 4 reproduces the checked in secp256k1.table
+#
+
+import sys
+
+# secp256k1 curve parameters
+P = 2**256 - 2**32 - 977
+GX = 0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798
+GY = 0x483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8
+
+# Add two affine points, None is the point at infinity
+def point_add(p, q):
+    if p is None:
+        return q
+    if q is None:
+        return p
+    if p[0] == q[0]:
+        if (p[1] + q[1]) % P == 0:
+            return None
+        lam = 3 * p[0] * p[0] * pow(2 * p[1], P - 2, P) % P
+    else:
+        lam = (q[1] - p[1]) * pow(q[0] - p[0], P - 2, P) % P
+    x = (lam * lam - p[0] - q[0]) % P
+    return (x, (lam * (p[0] - x) - p[1]) % P)
+
+# Split a field element into the 9 limbs of a bignum256
+def limbs(v):
+    return [(v >> (30 * i)) & 0x3FFFFFFF for i in range(8)] + [v >> 240]
+
+def format_limbs(v):
+    l = limbs(v)
+    return ", ".join(["0x%08x" % x for x in l[:8]] + ["0x%04x" % l[8]])
+
+def main():
+    w = int(sys.argv[1]) if len(sys.argv) > 1 else 4
+    if w < 2 or w > 8:
+        sys.exit("window width must be between 2 and 8")
+    rows = (256 + w - 1) // w
+    points = 1 << (w - 1)
+    digits = len(str(2 * points - 1))
+
+    out = []
+    base = (GX, GY)
+    for i in range(rows):
+        # base = 2^(w*i) * G, double = 2 * base
+        double = point_add(base, base)
+        p = base
+        out.append("\t{\n")
+        for j in range(points):
+            out.append("\t\t/* %*d*%d^%d*G: */\n" % (digits, 2 * j + 1, 1 << w, i))
+            out.append("\t\t{{{%s}},\n" % format_limbs(p[0]))
+            out.append("\t\t {{%s}}}%s\n" % (format_limbs(p[1]), "," if j < points - 1 else ""))
+            p = point_add(p, double)
+        out.append("\t},\n")
+        for _ in range(w):
+            base = point_add(base, base)
+    sys.stdout.write("".join(out))
+
+if __name__ == "__main__":
+    main()
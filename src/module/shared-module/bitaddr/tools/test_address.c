@@ -0,0 +1,148 @@
+// This program checks the base58check address and WIF private key path
+// of __init__.c with compressed and uncompressed public keys:
+// address_from_pubkey and privkey_wif_from_raw for fixed private keys,
+// and the BTC and LTC keypair functions for one entropy string.  The
+// expected strings come from a separate Python implementation; the ones
+// for private key 1 are the well known addresses of that key.
+//
+// Usage: test_address
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ecdsa.h"
+#include "secp256k1.h"
+
+// not in a header, see __init__.c
+void address_from_pubkey(const unsigned char *pubkey, size_t pubkey_length,
+                         unsigned char version_prefix,
+                         unsigned char address[40]);
+void privkey_wif_from_raw(unsigned char *privkey_raw,
+                          unsigned char version_prefix, int compressed,
+                          unsigned char *privkey);
+void shared_modules_bitaddr_get_address_privkey(
+    unsigned char *address, unsigned char *privkey,
+    const char *entropy_privkey, const char *entropy_ecdsa, int bch,
+    int compressed);
+void shared_modules_bitaddr_get_address_privkey_ltc(
+    unsigned char *address, unsigned char *privkey,
+    const char *entropy_privkey, const char *entropy_ecdsa, int compressed);
+
+static int checks, failures;
+
+static void check(int ok, const char *what, const char *vector) {
+  checks++;
+  if (!ok) {
+    failures++;
+    printf("FAIL %s: %s\n", what, vector);
+  }
+}
+
+static void read_hex(const char *hex, uint8_t *buf, size_t len) {
+  size_t i;
+  for (i = 0; i < len; i++) {
+    unsigned int v;
+    sscanf(hex + 2 * i, "%2x", &v);
+    buf[i] = v;
+  }
+}
+
+// private key, then the address and WIF key with the compressed and with
+// the uncompressed public key
+static const struct {
+  const char *priv;
+  const char *address33, *wif33;
+  const char *address65, *wif65;
+} vectors[] = {
+    {"0000000000000000000000000000000000000000000000000000000000000001",
+     "1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH",
+     "KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn",
+     "1EHNa6Q4Jz2uvNExL497mE43ikXhwF6kZm",
+     "5HpHagT65TZzG1PH3CSu63k8DbpvD8s5ip4nEB3kEsreAnchuDf"},
+    {"0000000000000000000000000000000000000000000000000000000000000002",
+     "1cMh228HTCiwS8ZsaakH8A8wze1JR5ZsP",
+     "KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU74NMTptX4",
+     "1LagHJk2FyCV2VzrNHVqg3gYG4TSYwDV4m",
+     "5HpHagT65TZzG1PH3CSu63k8DbpvD8s5ip4nEB3kEsreAvUcVfH"},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "1GrLCmVQXoyJXaPJQdqssNqwxvha1eUo2E",
+     "L5oLkpV3aqBjhki6LmvChTCV6odsp4SXM6FfU2Gppt5kFLaHLuZ9",
+     "1JPbzbsAx1HyaDQoLMapWGoqf9pD5uha5m",
+     "5Km2kuu7vtFDPpxywn4u3NLpbr5jKpTB3jsuDU2KYEqetqj84qw"},
+};
+
+static void test_vectors(void) {
+  uint8_t priv[32], pub33[33], pub65[65];
+  unsigned char out[70];
+  size_t i;
+
+  for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+    read_hex(vectors[i].priv, priv, 32);
+    ecdsa_get_public_key33(&secp256k1, priv, pub33);
+    ecdsa_get_public_key65(&secp256k1, priv, pub65);
+
+    memset(out, 0, sizeof(out));
+    address_from_pubkey(pub33, 33, 0x00, out);
+    check(strcmp((char *)out, vectors[i].address33) == 0,
+          "address_from_pubkey, compressed", vectors[i].address33);
+    memset(out, 0, sizeof(out));
+    privkey_wif_from_raw(priv, 0x80, 1, out);
+    check(strcmp((char *)out, vectors[i].wif33) == 0,
+          "privkey_wif_from_raw, compressed", vectors[i].wif33);
+
+    memset(out, 0, sizeof(out));
+    address_from_pubkey(pub65, 65, 0x00, out);
+    check(strcmp((char *)out, vectors[i].address65) == 0,
+          "address_from_pubkey, uncompressed", vectors[i].address65);
+    memset(out, 0, sizeof(out));
+    privkey_wif_from_raw(priv, 0x80, 0, out);
+    check(strcmp((char *)out, vectors[i].wif65) == 0,
+          "privkey_wif_from_raw, uncompressed", vectors[i].wif65);
+  }
+}
+
+// the private key is sha256("uBitAddr"), the second entropy string only
+// seeds the random numbers and must not change the keys
+static void test_keypairs(void) {
+  static const struct {
+    int ltc, compressed;
+    const char *address, *wif;
+  } keypairs[] = {
+      {0, 1, "1JV421Kx2N7zrf6eswVwZ4NPjPtd5B2Pim",
+       "L3uhBvCbUFEQzQje49PYBsoBTQTvasFGM2JxohngVutduPnU9yHY"},
+      {0, 0, "19J7iUrtTVpPDf8Ho8m8BrU5AyFdzBRRzk",
+       "5KLBvDxeGEeUe2JN5nrWitPF9hfGmNojSqL2KHVUXZpx2zaLK9L"},
+      {1, 1, "Lci1HDdn72N47Tnp45VEq5S9wcFuAjVMpT",
+       "T9jxdfVmsdD1mFNWbnLQQELZQG7EexGAAEDDfWRE4t4oRHPv9czm"},
+      {1, 0, "LTX4yhAiYA4SUTpSyGkRTsXqPBcv6R3DLq",
+       "6vdvPMWBAf7M7QCDbceUWHAR7BDjyBFmDWjC2UWWF29ZioVGz8D"},
+  };
+  static const char *const seeds[] = {"seed", "another seed"};
+  unsigned char address[40], wif[70];
+  size_t i, j;
+
+  for (i = 0; i < sizeof(keypairs) / sizeof(keypairs[0]); i++) {
+    for (j = 0; j < sizeof(seeds) / sizeof(seeds[0]); j++) {
+      memset(address, 0, sizeof(address));
+      memset(wif, 0, sizeof(wif));
+      if (keypairs[i].ltc) {
+        shared_modules_bitaddr_get_address_privkey_ltc(
+            address, wif, "uBitAddr", seeds[j], keypairs[i].compressed);
+      } else {
+        shared_modules_bitaddr_get_address_privkey(
+            address, wif, "uBitAddr", seeds[j], 0, keypairs[i].compressed);
+      }
+      check(strcmp((char *)address, keypairs[i].address) == 0 &&
+                strcmp((char *)wif, keypairs[i].wif) == 0,
+            "keypair", keypairs[i].address);
+    }
+  }
+}
+
+int main(void) {
+  test_vectors();
+  test_keypairs();
+  printf("test_address: %d checks, %d failures\n", checks, failures);
+  return failures != 0;
+}
@@ -0,0 +1,403 @@
+// This program checks bn_multiply and bn_square, the field kernels that
+// differ per target (64 bit limbs, UMAAL, portable C), with known
+// answers and algebraic identities modulo the secp256k1 prime and group
+// order, and derives one public key with them.  The scalar_* functions
+// of scalar.c get known answers at 0, 1, n - 1, n - 2, lambda and 2^128,
+// and scalar_split_lambda must give halves below 2^128 or above
+// n - 2^128.  It only needs stdio, so it also runs on an emulated
+// Cortex-M4 (make -C tools test-arm).
+//
+// Usage: test_bignum [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "options.h"
+#include "rand.h"
+#include "scalar.h"
+#include "secp256k1.h"
+
+static int checks, failures;
+
+static void check(int ok, const char *what, int i) {
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures < 10) printf("FAIL %s (%d)\n", what, i);
+  }
+}
+
+static void hex_to_bytes(const char *hex, uint8_t *out, size_t len) {
+  size_t i;
+  for (i = 0; i < len; i++) {
+    unsigned int v;
+    sscanf(hex + 2 * i, "%2x", &v);
+    out[i] = v;
+  }
+}
+
+static void read_hex(const char *hex, bignum256 *a) {
+  uint8_t buf[32];
+  hex_to_bytes(hex, buf, sizeof(buf));
+  bn_read_be(buf, a);
+}
+
+// fully reduces a partly reduced x modulo m
+static void reduce(bignum256 *x, const bignum256 *m) {
+  bn_fast_mod(x, m);
+  bn_mod(x, m);
+}
+
+static void random_element(bignum256 *a, const bignum256 *m) {
+  uint8_t buf[32];
+  random_buffer(buf, sizeof(buf));
+  bn_read_be(buf, a);
+  bn_mod(a, m);
+}
+
+// a * b = c, computed with python
+static const char *const mul_p_vectors[][3] = {
+    {"4e1195df020de59e0d65a33a4279f1183e7ae4e5d980e309f8b55adff2e61c3e",
+     "c02c0b965e023abee808f2b548d8d5193a8b5229be6f3121a6f16e2d41a449b3",
+     "de3de11a5adbfd94cdd7c14eeac4f73ab2a6fcc5d00461066304694194cc0f04"},
+    {"f55ff16f66f43360266b95db6f8fec01d76031054306ae4a4b380598f6cfd114",
+     "7dc96f776c8423e57a2785489a3f9c43fb6e756876d6ad9a9cac4aa4e72ec193",
+     "1cadd7a597f54634d51b1fc55608f073c34a9d226e8166c43cd451d6c1a764ee"},
+    {"2c3a4249d77070058649dbd822dcaf7957586fce428cfb2ca88b94741eda8b07",
+     "4814d92093ac8a0f4a2163ab87dee509ba306a58f5888be0edcb2fcd0712028b",
+     "0df87b078b244f43c939257cf4d79efc1bf88f7edaeab3aac53266c0ddef9723"},
+    {"f46dd28a5499d8efef0b8fb8ee1ec1c5a5e407c9381741d576ba8deb4f59ec3f",
+     "76a8277347f52530e1cf979175a178980b3a180d176165c985d85f7e142f1eed",
+     "267e7fb837d7a96e74739e8ab169db39c796ef8e260590a2b8e88290b64cf325"},
+    {"fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2e",
+     "fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2e",
+     "0000000000000000000000000000000000000000000000000000000000000001"},
+};
+
+static const char *const mul_n_vectors[][3] = {
+    {"8ab1daa8eb11341f6b00063b66f8e90ec6b9199820042d46f1baa543da78dc47",
+     "a66a160e573411a633564c6637c3db71d259e88c08fe4008f9d9a5d4897d1313",
+     "3eee491873ffdf27b00f48ee6fe651dd08a53ec5c2ee65f3315c2a95c3045936"},
+    {"9baec6541df5df89f9fef19ee87ce8e0022f51c4a6c9a9805236ca783d97d8b3",
+     "2dd56368823e4f8ac988e45a6b9ab4f78c9c1f1434bba622d09e879a535a10d7",
+     "1445c0bdd460412463db924d1e2a2bde3de4670bdb5790a9166bd106e7833399"},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "0000000000000000000000000000000000000000000000000000000000000001"},
+};
+
+static void test_vectors(const char *const v[][3], size_t n,
+                         const bignum256 *m, const char *name) {
+  bignum256 a, b, c;
+  size_t i;
+  for (i = 0; i < n; i++) {
+    read_hex(v[i][0], &a);
+    read_hex(v[i][1], &b);
+    read_hex(v[i][2], &c);
+    bn_multiply(&a, &b, m);
+    reduce(&b, m);
+    check(bn_is_equal(&b, &c), name, i);
+  }
+}
+
+static void test_identities(const bignum256 *m, const char *name, int n) {
+  bignum256 a, b, c, x, y, one;
+  int i;
+  bn_one(&one);
+  for (i = 0; i < n; i++) {
+    random_element(&a, m);
+    random_element(&b, m);
+    random_element(&c, m);
+
+    // (a * b) * c = a * (b * c)
+    x = b;
+    bn_multiply(&a, &x, m);
+    bn_multiply(&c, &x, m);
+    reduce(&x, m);
+    y = c;
+    bn_multiply(&b, &y, m);
+    bn_multiply(&a, &y, m);
+    reduce(&y, m);
+    check(bn_is_equal(&x, &y), name, i);
+
+    // a * (b + c) = a * b + a * c
+    x = b;
+    bn_addmod(&x, &c, m);
+    bn_multiply(&a, &x, m);
+    reduce(&x, m);
+    y = b;
+    bn_multiply(&a, &y, m);
+    bn_multiply(&a, &c, m);
+    bn_addmod(&y, &c, m);
+    reduce(&y, m);
+    check(bn_is_equal(&x, &y), name, i);
+
+    // a^2 = a * a
+    x = a;
+    bn_square(&x, m);
+    reduce(&x, m);
+    y = a;
+    bn_multiply(&a, &y, m);
+    reduce(&y, m);
+    check(bn_is_equal(&x, &y), name, i);
+
+    // a * a^-1 = 1, the inverse does not use bn_multiply
+    if (!bn_is_zero(&a)) {
+      x = a;
+      bn_inverse(&x, m);
+      bn_multiply(&a, &x, m);
+      reduce(&x, m);
+      check(bn_is_equal(&x, &one), name, i);
+    }
+  }
+}
+
+static void test_public_key(void) {
+  // k = sha256("uBitAddr") mod n, computed with python
+  uint8_t k[32], pub[65], expected[65];
+  hex_to_bytes(
+      "c797d314d83d8dc227c28008e4d9a4be49fb9e513f34e88099d1768960407f9e", k,
+      sizeof(k));
+  hex_to_bytes(
+      "046a14b4f0f19ba9620a836b6f7083f2955850a8b394a194e11ca0bc931236f85a"
+      "5e795eb7ae1b793e7ec082211f08e70569d164be43e7d5202e2ca045406fc609",
+      expected, sizeof(expected));
+  ecdsa_get_public_key65(&secp256k1, k, pub);
+  check(memcmp(pub, expected, sizeof(pub)) == 0, "public key", 0);
+}
+
+// the scalars 0, 1, n - 1, n - 2, lambda and 2^128
+static const char *const scalar_values[] = {
+    "0000000000000000000000000000000000000000000000000000000000000000",
+    "0000000000000000000000000000000000000000000000000000000000000001",
+    "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+    "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd036413f",
+    "5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd72",
+    "0000000000000000000000000000000100000000000000000000000000000000",
+};
+
+// scalar_add and scalar_mul of scalar_values[i] and scalar_values[j],
+// computed with python
+static const struct {
+  int i, j;
+  const char *sum, *product;
+} scalar_pair_vectors[] = {
+    {0, 0, "0000000000000000000000000000000000000000000000000000000000000000",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {0, 1, "0000000000000000000000000000000000000000000000000000000000000001",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {0, 2, "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {0, 3, "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd036413f",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {0, 4, "5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd72",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {0, 5, "0000000000000000000000000000000100000000000000000000000000000000",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {1, 1, "0000000000000000000000000000000000000000000000000000000000000002",
+     "0000000000000000000000000000000000000000000000000000000000000001"},
+    {1, 2, "0000000000000000000000000000000000000000000000000000000000000000",
+     "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140"},
+    {1, 3, "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd036413f"},
+    {1, 4, "5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd73",
+     "5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd72"},
+    {1, 5, "0000000000000000000000000000000100000000000000000000000000000001",
+     "0000000000000000000000000000000100000000000000000000000000000000"},
+    {2, 2, "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd036413f",
+     "0000000000000000000000000000000000000000000000000000000000000001"},
+    {2, 3, "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd036413e",
+     "0000000000000000000000000000000000000000000000000000000000000002"},
+    {2, 4, "5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd71",
+     "ac9c52b33fa3cf1f5ad9e3fd77ed9ba4a880b9fc8ec739c2e0cfc810b51283cf"},
+    {2, 5, "00000000000000000000000000000000ffffffffffffffffffffffffffffffff",
+     "fffffffffffffffffffffffffffffffdbaaedce6af48a03bbfd25e8cd0364141"},
+    {3, 3, "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd036413d",
+     "0000000000000000000000000000000000000000000000000000000000000004"},
+    {3, 4, "5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd70",
+     "5938a5667f479e3eb5b3c7faefdb374a965297126e45d34a01cd319499eec65d"},
+    {3, 5, "00000000000000000000000000000000fffffffffffffffffffffffffffffffe",
+     "fffffffffffffffffffffffffffffffcbaaedce6af48a03bbfd25e8cd0364141"},
+    {4, 4, "a6c75a9980b861c14a4c38051024c8b4245c45d44102ccf1be052cf836477ae4",
+     "ac9c52b33fa3cf1f5ad9e3fd77ed9ba4a880b9fc8ec739c2e0cfc810b51283ce"},
+    {4, 5, "5363ad4cc05c30e0a5261c028812645b122e22ea20816678df02967c1b23bd72",
+     "7c261be545b79a17b3f1f9610211f8e1b5648599239dc82eca62ac2c7cddab26"},
+    {5, 5, "0000000000000000000000000000000200000000000000000000000000000000",
+     "000000000000000000000000000000014551231950b75fc4402da1732fc9bebf"},
+};
+
+// scalar_negate and scalar_inverse of scalar_values, 0 has no inverse
+static const char *const scalar_unary_vectors[][2] = {
+    {"0000000000000000000000000000000000000000000000000000000000000000",
+     NULL},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "0000000000000000000000000000000000000000000000000000000000000001"},
+    {"0000000000000000000000000000000000000000000000000000000000000001",
+     "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140"},
+    {"0000000000000000000000000000000000000000000000000000000000000002",
+     "7fffffffffffffffffffffffffffffff5d576e7357a4501ddfe92f46681b20a0"},
+    {"ac9c52b33fa3cf1f5ad9e3fd77ed9ba4a880b9fc8ec739c2e0cfc810b51283cf",
+     "ac9c52b33fa3cf1f5ad9e3fd77ed9ba4a880b9fc8ec739c2e0cfc810b51283ce"},
+    {"fffffffffffffffffffffffffffffffdbaaedce6af48a03bbfd25e8cd0364141",
+     "50a51ac834b9ec244b0dff665588b13e9984d5b3cf80ef0fd6a23766a3ee9f22"},
+};
+
+// k, r1 and r2 of scalar_split_lambda, the scalar_values and two more,
+// computed with python like libsecp256k1 splits
+static const char *const scalar_split_vectors[][3] = {
+    {"0000000000000000000000000000000000000000000000000000000000000000",
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {"0000000000000000000000000000000000000000000000000000000000000001",
+     "0000000000000000000000000000000000000000000000000000000000000001",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd036413f",
+     "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd036413f",
+     "0000000000000000000000000000000000000000000000000000000000000000"},
+    {"5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd72",
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     "0000000000000000000000000000000000000000000000000000000000000001"},
+    {"0000000000000000000000000000000100000000000000000000000000000000",
+     "fffffffffffffffffffffffffffffffea5e48bef0665ac4568114dff32f17169",
+     "fffffffffffffffffffffffffffffffe8a280ac50774346dd765cda83db1562c"},
+    {"7fffffffffffffffffffffffffffffff5d576e7357a4501ddfe92f46681b20a0",
+     "00000000000000000000000000000000a2a8918ca85bafe22016d0b917e4dd76",
+     "fffffffffffffffffffffffffffffffe60d0868c82ab920e7c5e672a9418c46a"},
+    {"8ab1daa8eb11341f6b00063b66f8e90ec6b9199820042d46f1baa543da78dc47",
+     "fffffffffffffffffffffffffffffffea50cfb6f86096b7ccdc84ac388e2985c",
+     "fffffffffffffffffffffffffffffffe8d45cf048390f07edc755428a922aa58"},
+};
+
+// scalar_read_be input, the reduced scalar and the return value
+static const struct {
+  const char *in, *out;
+  int valid;
+} scalar_read_vectors[] = {
+    {"0000000000000000000000000000000000000000000000000000000000000000",
+     "0000000000000000000000000000000000000000000000000000000000000000", 1},
+    {"0000000000000000000000000000000000000000000000000000000000000001",
+     "0000000000000000000000000000000000000000000000000000000000000001", 1},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140", 1},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141",
+     "0000000000000000000000000000000000000000000000000000000000000000", 0},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364142",
+     "0000000000000000000000000000000000000000000000000000000000000001", 0},
+    {"5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd72",
+     "5363ad4cc05c30e0a5261c028812645a122e22ea20816678df02967c1b23bd72", 1},
+    {"ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+     "000000000000000000000000000000014551231950b75fc4402da1732fc9bebe", 0},
+};
+
+// 1 iff r is below 2^128 or above n - 2^128
+static int scalar_is_short(const bignum256 *r) {
+  bignum256 bound;
+  read_hex("0000000000000000000000000000000100000000000000000000000000000000",
+           &bound);
+  if (bn_is_less(r, &bound)) return 1;
+  bn_subtract(&secp256k1.order, &bound, &bound);
+  return bn_is_less(&bound, r);
+}
+
+// k = r1 + r2 * lambda with short r1 and r2
+static int split_ok(const bignum256 *k, const bignum256 *r1,
+                    const bignum256 *r2) {
+  bignum256 lambda, x;
+  read_hex(scalar_values[4], &lambda);
+  scalar_mul(&x, r2, &lambda);
+  scalar_add(&x, &x, r1);
+  return bn_is_equal(&x, k) && scalar_is_short(r1) && scalar_is_short(r2);
+}
+
+static void test_scalar_vectors(void) {
+  bignum256 a, b, c, r, r2;
+  uint8_t buf[32];
+  size_t i;
+
+  for (i = 0; i < sizeof(scalar_pair_vectors) / sizeof(scalar_pair_vectors[0]);
+       i++) {
+    read_hex(scalar_values[scalar_pair_vectors[i].i], &a);
+    read_hex(scalar_values[scalar_pair_vectors[i].j], &b);
+    read_hex(scalar_pair_vectors[i].sum, &c);
+    scalar_add(&r, &a, &b);
+    check(bn_is_equal(&r, &c), "scalar_add", i);
+    scalar_add(&r, &b, &a);
+    check(bn_is_equal(&r, &c), "scalar_add", i);
+    read_hex(scalar_pair_vectors[i].product, &c);
+    scalar_mul(&r, &a, &b);
+    check(bn_is_equal(&r, &c), "scalar_mul", i);
+    scalar_mul(&r, &b, &a);
+    check(bn_is_equal(&r, &c), "scalar_mul", i);
+  }
+
+  for (i = 0; i < sizeof(scalar_values) / sizeof(scalar_values[0]); i++) {
+    read_hex(scalar_values[i], &a);
+    read_hex(scalar_unary_vectors[i][0], &c);
+    scalar_negate(&r, &a);
+    check(bn_is_equal(&r, &c), "scalar_negate", i);
+    if (scalar_unary_vectors[i][1] != NULL) {
+      read_hex(scalar_unary_vectors[i][1], &c);
+      scalar_inverse(&r, &a);
+      check(bn_is_equal(&r, &c), "scalar_inverse", i);
+    }
+    check(scalar_is_valid(&a) == (i != 0), "scalar_is_valid", i);
+  }
+
+  for (i = 0;
+       i < sizeof(scalar_split_vectors) / sizeof(scalar_split_vectors[0]);
+       i++) {
+    read_hex(scalar_split_vectors[i][0], &a);
+    read_hex(scalar_split_vectors[i][1], &b);
+    read_hex(scalar_split_vectors[i][2], &c);
+    scalar_split_lambda(&r, &r2, &a);
+    check(bn_is_equal(&r, &b) && bn_is_equal(&r2, &c),
+          "scalar_split_lambda", i);
+    check(split_ok(&a, &r, &r2), "scalar_split_lambda bound", i);
+  }
+
+  for (i = 0; i < sizeof(scalar_read_vectors) / sizeof(scalar_read_vectors[0]);
+       i++) {
+    hex_to_bytes(scalar_read_vectors[i].in, buf, sizeof(buf));
+    read_hex(scalar_read_vectors[i].out, &c);
+    check(scalar_read_be(buf, &r) == scalar_read_vectors[i].valid &&
+              bn_is_equal(&r, &c),
+          "scalar_read_be", i);
+  }
+}
+
+// scalar_split_lambda of random scalars
+static void test_scalar_split(int n) {
+  bignum256 k, r1, r2;
+  int i;
+  for (i = 0; i < n; i++) {
+    random_element(&k, &secp256k1.order);
+    scalar_split_lambda(&r1, &r2, &k);
+    check(split_ok(&k, &r1, &r2), "scalar_split_lambda, random", i);
+  }
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 2000;
+
+  random_reseed(1);
+  test_vectors(mul_p_vectors, sizeof(mul_p_vectors) / sizeof(mul_p_vectors[0]),
+               &secp256k1.prime, "mul mod p");
+  test_vectors(mul_n_vectors, sizeof(mul_n_vectors) / sizeof(mul_n_vectors[0]),
+               &secp256k1.order, "mul mod n");
+  test_identities(&secp256k1.prime, "identities mod p", n);
+  test_identities(&secp256k1.order, "identities mod n", n);
+  test_public_key();
+  test_scalar_vectors();
+  test_scalar_split(n);
+
+  printf("test_bignum (USE_BN_UMAAL=%d, USE_BN_64BIT_LIMBS=%d): %d checks, "
+         "%d failures\n",
+         USE_BN_UMAAL, USE_BN_64BIT_LIMBS, checks, failures);
+  return failures != 0;
+}
@@ -0,0 +1,126 @@
+// This program checks scalar_multiply_runtime_load with a table file
+// written by mkcpfile.py.  Copies of the file with one point changed and
+// the header hash recomputed, as a stale or forged file would have, must
+// be rejected.  The file itself must load and give the same public keys
+// as point_multiply.  With checked, all of this goes through
+// scalar_multiply_runtime_load_checked, which does not hash the points
+// but must still reject the forged header hashes.
+//
+// Usage: test_cpfile <table file> <scratch file> [checked]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "rand.h"
+#include "secp256k1.h"
+#include "sha2.h"
+
+#define FILE_OFFSET 4096
+#define HEADER_SHA256 32
+#define POINT_SIZE sizeof(curve_point)
+
+static int checks, failures;
+static int (*load)(const char *path) = scalar_multiply_runtime_load;
+
+static void check(int ok, const char *what) {
+  checks++;
+  if (!ok) {
+    failures++;
+    printf("FAIL %s\n", what);
+  }
+}
+
+static uint8_t *read_file(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  uint8_t *data;
+  long n;
+  if (f == NULL) return NULL;
+  fseek(f, 0, SEEK_END);
+  n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = malloc(n);
+  if (data == NULL || fread(data, 1, n, f) != (size_t)n) {
+    free(data);
+    fclose(f);
+    return NULL;
+  }
+  fclose(f);
+  *size = n;
+  return data;
+}
+
+static void write_file(const char *path, const uint8_t *data, size_t size) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL || fwrite(data, 1, size, f) != size) {
+    printf("cannot write %s\n", path);
+    exit(1);
+  }
+  fclose(f);
+}
+
+// writes data to path with point index replaced by the point q and the
+// header hash updated to match
+static void write_forged(const char *path, const uint8_t *data, size_t size,
+                         size_t index, const curve_point *q) {
+  uint8_t *copy = malloc(size);
+  memcpy(copy, data, size);
+  memcpy(copy + FILE_OFFSET + index * POINT_SIZE, q, POINT_SIZE);
+  sha256_Raw(copy + FILE_OFFSET, size - FILE_OFFSET, copy + HEADER_SHA256);
+  write_file(path, copy, size);
+  free(copy);
+}
+
+int main(int argc, char **argv) {
+  uint8_t *data;
+  size_t size, points;
+  curve_point q, r1, r2;
+  bignum256 k;
+  uint8_t buf[32];
+  int i;
+
+  if (argc < 3 || argc > 4 || (argc == 4 && strcmp(argv[3], "checked")) ||
+      (data = read_file(argv[1], &size)) == NULL) {
+    printf("usage: test_cpfile <table file> <scratch file> [checked]\n");
+    return 1;
+  }
+  if (argc == 4) {
+    load = scalar_multiply_runtime_load_checked;
+  }
+  points = (size - FILE_OFFSET) / POINT_SIZE;
+
+  // a valid curve point in the wrong place: 2 * G as the first point
+  q = secp256k1.G;
+  point_double(&secp256k1, &q);
+  write_forged(argv[2], data, size, 0, &q);
+  check(!load(argv[2]), "forged first point");
+
+  // G in the middle of the last row
+  write_forged(argv[2], data, size, points - 2, &secp256k1.G);
+  check(!load(argv[2]), "forged inner point");
+
+  // a truncated file
+  write_file(argv[2], data, size - POINT_SIZE);
+  check(!load(argv[2]), "truncated file");
+
+  check(load(argv[1]), "table file");
+  check(!load(argv[1]), "second table file");
+
+  random_reseed(1);
+  for (i = 0; i < 100; i++) {
+    random_buffer(buf, sizeof(buf));
+    bn_read_be(buf, &k);
+    bn_mod(&k, &secp256k1.order);
+    scalar_multiply(&secp256k1, &k, &r1);
+    point_multiply(&secp256k1, &k, &secp256k1.G, &r2);
+    check(point_is_equal(&r1, &r2), "public key");
+  }
+
+  free(data);
+  remove(argv[2]);
+  printf("test_cpfile%s: %d checks, %d failures\n",
+         argc == 4 ? " (checked)" : "", checks, failures);
+  return failures != 0;
+}
@@ -0,0 +1,198 @@
+// This program checks point_multiply_dual, k1 * G + k2 * p, against
+// scalar_multiply of k1 + k2 * d for p = d * G.  With p = G and small k2
+// the comb additions of k1 * G often meet +-k2 * G on the way; those
+// sums used to come out as the point at infinity.
+//
+// It also runs ecdsa_verify_digest, which is built on point_multiply_dual,
+// on signed digests: a valid signature gives 0 with either public key
+// form and also with s replaced by n - s, and each kind of tampering
+// gives its return code, 1 for a bad public key, 2 for r or s out of
+// range, 3 for u1 * G + u2 * p at infinity and 4 for a mismatch.
+//
+// Usage: test_dual [trials]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "memzero.h"
+#include "rand.h"
+#include "secp256k1.h"
+
+static int checks, failures;
+
+static void check(int ok, const char *what, int i) {
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures < 10) printf("FAIL %s (%d)\n", what, i);
+  }
+}
+
+static void read_hex(const char *hex, bignum256 *a) {
+  uint8_t buf[32];
+  int i;
+  for (i = 0; i < 32; i++) {
+    unsigned int v;
+    sscanf(hex + 2 * i, "%2x", &v);
+    buf[i] = v;
+  }
+  bn_read_be(buf, a);
+}
+
+static void random_scalar(bignum256 *k) {
+  uint8_t buf[32];
+  random_buffer(buf, sizeof(buf));
+  bn_read_be(buf, k);
+  bn_mod(k, &secp256k1.order);
+}
+
+// checks point_multiply_dual(k1, k2, d * G) against (k1 + k2 d) * G
+static void check_dual(const bignum256 *k1, const bignum256 *k2,
+                       const bignum256 *d, const char *what, int i) {
+  curve_point p, r1, r2;
+  bignum256 k;
+
+  scalar_multiply(&secp256k1, d, &p);
+  point_multiply_dual(&secp256k1, k1, k2, &p, &r1);
+
+  k = *k2;
+  bn_multiply(d, &k, &secp256k1.order);
+  bn_addmod(&k, k1, &secp256k1.order);
+  bn_mod(&k, &secp256k1.order);
+  scalar_multiply(&secp256k1, &k, &r2);
+  check(point_is_equal(&r1, &r2) ||
+            (point_is_infinity(&r1) && point_is_infinity(&r2)),
+        what, i);
+}
+
+// signs random digests with random keys and tampers with the result
+static void test_verify(int n) {
+  uint8_t priv[32], pub33[33], pub65[65], digest[32], sig[64], bad[64];
+  uint8_t badpub[65];
+  bignum256 k, s;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    do {
+      random_buffer(priv, sizeof(priv));
+      bn_read_be(priv, &k);
+    } while (bn_is_zero(&k) || !bn_is_less(&k, &secp256k1.order));
+    random_buffer(digest, sizeof(digest));
+    ecdsa_get_public_key33(&secp256k1, priv, pub33);
+    ecdsa_get_public_key65(&secp256k1, priv, pub65);
+    check(ecdsa_sign_digest(&secp256k1, priv, digest, sig, NULL, NULL) == 0,
+          "ecdsa_sign_digest", i);
+
+    check(ecdsa_verify_digest(&secp256k1, pub33, sig, digest) == 0,
+          "verify, compressed key", i);
+    check(ecdsa_verify_digest(&secp256k1, pub65, sig, digest) == 0,
+          "verify, uncompressed key", i);
+
+    // the signer picks low s, verification takes high s as well
+    memcpy(bad, sig, 64);
+    bn_read_be(sig + 32, &s);
+    bn_subtract(&secp256k1.order, &s, &s);
+    bn_write_be(&s, bad + 32);
+    check(ecdsa_verify_digest(&secp256k1, pub33, bad, digest) == 0,
+          "verify, high s", i);
+
+    // 1: not a public key
+    memcpy(badpub, pub33, 33);
+    badpub[0] = 0x05;
+    check(ecdsa_verify_digest(&secp256k1, badpub, sig, digest) == 1,
+          "verify, bad prefix = 1", i);
+    memcpy(badpub, pub65, 65);
+    badpub[64] ^= 1;
+    check(ecdsa_verify_digest(&secp256k1, badpub, sig, digest) == 1,
+          "verify, point off the curve = 1", i);
+
+    // 2: r or s zero or not below n
+    memcpy(bad, sig, 64);
+    memset(bad + (i & 1) * 32, 0, 32);
+    check(ecdsa_verify_digest(&secp256k1, pub33, bad, digest) == 2,
+          "verify, r or s = 0 gives 2", i);
+    memcpy(bad, sig, 64);
+    bn_write_be(&secp256k1.order, bad + (i & 1) * 32);
+    check(ecdsa_verify_digest(&secp256k1, pub33, bad, digest) == 2,
+          "verify, r or s = n gives 2", i);
+
+    // 4: anything else changed
+    memcpy(bad, sig, 64);
+    bad[i % 64] ^= 1 << (i % 8);
+    check(ecdsa_verify_digest(&secp256k1, pub33, bad, digest) == 4,
+          "verify, flipped signature bit gives 4", i);
+    digest[i % 32] ^= 0x80;
+    check(ecdsa_verify_digest(&secp256k1, pub33, sig, digest) == 4,
+          "verify, flipped digest bit gives 4", i);
+    digest[i % 32] ^= 0x80;
+    priv[31] ^= 1;
+    ecdsa_get_public_key33(&secp256k1, priv, badpub);
+    check(ecdsa_verify_digest(&secp256k1, badpub, sig, digest) == 4,
+          "verify, other key gives 4", i);
+  }
+
+  // 3: with p = G, the digest z = n - r makes z / s * G + r / s * G the
+  // point at infinity for every s
+  memset(priv, 0, sizeof(priv));
+  priv[31] = 1;
+  ecdsa_get_public_key33(&secp256k1, priv, pub33);
+  for (i = 0; i < 8; i++) {
+    random_scalar(&k);
+    bn_addi(&k, 1);
+    bn_write_be(&k, sig);
+    random_buffer(sig + 32, 32);
+    sig[32] &= 0x7f;
+    sig[63] |= 1;
+    bn_subtract(&secp256k1.order, &k, &k);
+    bn_write_be(&k, digest);
+    check(ecdsa_verify_digest(&secp256k1, pub33, sig, digest) == 3,
+          "verify, u1 * G + u2 * p at infinity gives 3", i);
+  }
+
+  memzero(priv, sizeof(priv));
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 1280;
+  bignum256 k1, k2, d;
+  int i;
+
+  random_reseed(1);
+  bn_one(&d);
+
+  // p = G, k2 = 9 meets an intermediate comb sum of k1 * G
+  read_hex("781f9c58d6645fa9e8a8529f035efa259b08923d10c67fd994b2b8fda02f34a7",
+           &k1);
+  bn_read_uint32(9, &k2);
+  check_dual(&k1, &k2, &d, "k1 = 0x781f..., k2 = 9, p = G", 0);
+
+  // p = G with small k2, and k1 = -k2 for the real point at infinity
+  for (i = 0; i < n; i++) {
+    random_scalar(&k1);
+    bn_read_uint32(i % 64 + 1, &k2);
+    check_dual(&k1, &k2, &d, "small k2, p = G", i);
+  }
+  bn_read_uint32(5, &k2);
+  bn_subtract(&secp256k1.order, &k2, &k1);
+  check_dual(&k1, &k2, &d, "k1 = -k2, p = G", 0);
+
+  // zero scalars and random points
+  bn_zero(&k1);
+  check_dual(&k1, &k2, &d, "k1 = 0", 0);
+  bn_zero(&k2);
+  random_scalar(&k1);
+  check_dual(&k1, &k2, &d, "k2 = 0", 0);
+  for (i = 0; i < n / 8; i++) {
+    random_scalar(&k1);
+    random_scalar(&k2);
+    random_scalar(&d);
+    check_dual(&k1, &k2, &d, "random", i);
+  }
+  test_verify(n / 8);
+
+  printf("test_dual: %d checks, %d failures\n", checks, failures);
+  return failures != 0;
+}
@@ -0,0 +1,236 @@
+// This program counts the field multiplications (M), squarings (S) and
+// inversions (I) of the point formulas and of scalar_multiply and
+// point_multiply.  The Makefile links it with -Wl,--wrap for bn_multiply,
+// bn_square, their secp256k1 versions and bn_inverse, so every call from
+// ecdsa.c into bignum.c goes through the counters below.
+//
+// The formulas must cost exactly what ecdsa_jacobian.h documents, and
+// scalar_multiply exactly one conversion to jacobian coordinates, the
+// comb additions and one conversion back.  The results are checked too:
+// the cheaper addition must agree with the full one, and scalar_multiply
+// with point_multiply.
+//
+// Usage: test_opcount [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "options.h"
+#include "rand.h"
+#include "secp256k1.h"
+
+// not in ecdsa.h, the generic instances of ecdsa_jacobian.h
+void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2,
+                        const ecdsa_curve *curve);
+void point_jacobian_madd(const curve_point *p1, jacobian_curve_point *p2,
+                         const ecdsa_curve *curve);
+void point_jacobian_add_coz(jacobian_curve_point *p1, jacobian_curve_point *p2,
+                            const ecdsa_curve *curve);
+void point_jacobian_double(jacobian_curve_point *p, const ecdsa_curve *curve);
+int point_jacobian_add_jacobian(const jacobian_curve_point *p1,
+                                jacobian_curve_point *p2,
+                                const ecdsa_curve *curve);
+void curve_to_jacobian(const curve_point *p, jacobian_curve_point *jp,
+                       const bignum256 *prime);
+void jacobian_to_curve(const jacobian_curve_point *jp, curve_point *p,
+                       const bignum256 *prime);
+
+void __real_bn_multiply(const bignum256 *k, bignum256 *x,
+                        const bignum256 *prime);
+void __real_bn_square(bignum256 *x, const bignum256 *prime);
+void __real_bn_multiply_secp256k1(const bignum256 *k, bignum256 *x);
+void __real_bn_square_secp256k1(bignum256 *x);
+void __real_bn_inverse(bignum256 *x, const bignum256 *prime);
+
+typedef struct {
+  int m, s, i;
+} opcount;
+
+static opcount ops;
+
+void __wrap_bn_multiply(const bignum256 *k, bignum256 *x,
+                        const bignum256 *prime) {
+  ops.m++;
+  __real_bn_multiply(k, x, prime);
+}
+
+void __wrap_bn_square(bignum256 *x, const bignum256 *prime) {
+  ops.s++;
+  __real_bn_square(x, prime);
+}
+
+void __wrap_bn_multiply_secp256k1(const bignum256 *k, bignum256 *x) {
+  ops.m++;
+  __real_bn_multiply_secp256k1(k, x);
+}
+
+void __wrap_bn_square_secp256k1(bignum256 *x) {
+  ops.s++;
+  __real_bn_square_secp256k1(x);
+}
+
+void __wrap_bn_inverse(bignum256 *x, const bignum256 *prime) {
+  ops.i++;
+  __real_bn_inverse(x, prime);
+}
+
+static int checks, failures;
+
+static void check(int ok, const char *what, int i) {
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures < 10) printf("FAIL %s (%d)\n", what, i);
+  }
+}
+
+static void check_ops(const char *what, opcount got, int m, int s, int i) {
+  checks++;
+  printf("%-28s %5d M %5d S %2d I\n", what, got.m, got.s, got.i);
+  if (got.m != m || got.s != s || got.i != i) {
+    failures++;
+    printf("FAIL %s, expected %d M %d S %d I\n", what, m, s, i);
+  }
+}
+
+static void random_scalar(bignum256 *k) {
+  uint8_t buf[32];
+  do {
+    random_buffer(buf, sizeof(buf));
+    bn_read_be(buf, k);
+    bn_mod(k, &secp256k1.order);
+  } while (bn_is_zero(k));
+}
+
+static void random_point(curve_point *p) {
+  bignum256 k;
+  random_scalar(&k);
+  scalar_multiply(&secp256k1, &k, p);
+}
+
+static int is_infinity(const jacobian_curve_point *jp) {
+  bignum256 z = jp->z;
+  bn_mod(&z, &secp256k1.prime);
+  return bn_is_zero(&z);
+}
+
+static void test_formulas(void) {
+  curve_point p, q, r1, r2;
+  jacobian_curve_point jp, jq, jr;
+
+  random_point(&p);
+  random_point(&q);
+  curve_to_jacobian(&q, &jq, &secp256k1.prime);
+  curve_to_jacobian(&p, &jp, &secp256k1.prime);
+
+  memset(&ops, 0, sizeof(ops));
+  jr = jq;
+  point_jacobian_add(&p, &jr, &secp256k1);
+  check_ops("point_jacobian_add", ops, 8, 4, 0);
+  jacobian_to_curve(&jr, &r1, &secp256k1.prime);
+
+  memset(&ops, 0, sizeof(ops));
+  jr = jq;
+  point_jacobian_madd(&p, &jr, &secp256k1);
+  check_ops("point_jacobian_madd", ops, 7, 4, 0);
+  jacobian_to_curve(&jr, &r2, &secp256k1.prime);
+  check(point_is_equal(&r1, &r2), "madd = add", 0);
+
+  memset(&ops, 0, sizeof(ops));
+  jr = jq;
+  point_jacobian_add_jacobian(&jp, &jr, &secp256k1);
+  check_ops("point_jacobian_add_jacobian", ops, 12, 4, 0);
+  jacobian_to_curve(&jr, &r2, &secp256k1.prime);
+  check(point_is_equal(&r1, &r2), "add_jacobian = add", 0);
+
+  memset(&ops, 0, sizeof(ops));
+  jr = jq;
+  point_jacobian_double(&jr, &secp256k1);
+  check_ops("point_jacobian_double", ops, 3, 4, 0);
+
+  // p and q over the same z for the co-Z addition
+  jr = jp;
+  jp.z = jq.z;
+  jp.x = jq.z;
+  bn_square(&jp.x, &secp256k1.prime);
+  jp.y = jp.x;
+  bn_multiply(&jq.z, &jp.y, &secp256k1.prime);
+  bn_multiply(&p.x, &jp.x, &secp256k1.prime);
+  bn_multiply(&p.y, &jp.y, &secp256k1.prime);
+  memset(&ops, 0, sizeof(ops));
+  jr = jq;
+  point_jacobian_add_coz(&jp, &jr, &secp256k1);
+  check_ops("point_jacobian_add_coz", ops, 5, 2, 0);
+  jacobian_to_curve(&jr, &r2, &secp256k1.prime);
+  check(point_is_equal(&r1, &r2), "add_coz = add", 0);
+
+  // the exceptional cases leave z = 0, see point_jacobian_madd
+  jr = jq;
+  point_jacobian_madd(&q, &jr, &secp256k1);
+  check(is_infinity(&jr), "madd q + q", 0);
+  r2 = q;
+  bn_subtract(&secp256k1.prime, &q.y, &r2.y);
+  jr = jq;
+  point_jacobian_madd(&r2, &jr, &secp256k1);
+  check(is_infinity(&jr), "madd -q + q", 0);
+}
+
+static void test_multiply(int n) {
+  const int rows = (256 + PRECOMPUTED_CP_WINDOW - 1) / PRECOMPUTED_CP_WINDOW;
+  opcount to_jacobian, to_curve;
+  curve_point p, r1, r2;
+  jacobian_curve_point jp;
+  bignum256 k;
+  int i;
+
+  random_point(&p);
+  memset(&ops, 0, sizeof(ops));
+  curve_to_jacobian(&p, &jp, &secp256k1.prime);
+  to_jacobian = ops;
+  memset(&ops, 0, sizeof(ops));
+  jacobian_to_curve(&jp, &r1, &secp256k1.prime);
+  to_curve = ops;
+
+  // one conversion each way, rows - 2 cheap additions and the full
+  // addition of the last row
+  random_scalar(&k);
+  memset(&ops, 0, sizeof(ops));
+  scalar_multiply(&secp256k1, &k, &r1);
+  check_ops("scalar_multiply", ops,
+            to_jacobian.m + (rows - 2) * 7 + 8 + to_curve.m,
+            to_jacobian.s + (rows - 2) * 4 + 4 + to_curve.s,
+            to_jacobian.i + to_curve.i);
+  memset(&ops, 0, sizeof(ops));
+  point_multiply(&secp256k1, &k, &secp256k1.G, &r2);
+  printf("%-28s %5d M %5d S %2d I\n", "point_multiply", ops.m, ops.s, ops.i);
+  check(point_is_equal(&r1, &r2), "scalar_multiply = point_multiply", 0);
+
+  // small scalars, scalars near the order and random ones
+  for (i = 0; i < n; i++) {
+    if (i < 16) {
+      bn_read_uint32(i + 1, &k);
+    } else if (i < 32) {
+      bn_read_uint32(i - 15, &k);
+      bn_subtract(&secp256k1.order, &k, &k);
+    } else {
+      random_scalar(&k);
+    }
+    scalar_multiply(&secp256k1, &k, &r1);
+    point_multiply(&secp256k1, &k, &secp256k1.G, &r2);
+    check(point_is_equal(&r1, &r2), "scalar_multiply = point_multiply", i);
+  }
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 500;
+
+  random_reseed(1);
+  test_formulas();
+  test_multiply(n);
+  printf("test_opcount (w = %d): %d checks, %d failures\n",
+         PRECOMPUTED_CP_WINDOW, checks, failures);
+  return failures != 0;
+}
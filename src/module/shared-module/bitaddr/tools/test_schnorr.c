@@ -0,0 +1,368 @@
+// This program checks BIP340 signature verification and the Pippenger
+// multi multiplication under it.
+//
+// schnorr_verify_digest must accept and reject the BIP340 test vectors
+// 0-14 (15-18 sign messages of other lengths than 32 bytes, which the
+// API does not take).  schnorr_verify_batch must accept batches of
+// signatures made here, with sizes below, at and above
+// SCHNORR_VERIFY_BATCH_SIZE, and reject them with any one signature,
+// message or key tampered.  point_multiply_multi must agree with
+// separate point_multiply calls, also when bucket sums cancel to the
+// point at infinity.
+//
+// Usage: test_schnorr [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "options.h"
+#include "rand.h"
+#include "schnorr.h"
+#include "secp256k1.h"
+#include "sha2.h"
+
+static int checks, failures;
+
+static void check(int ok, const char *what, int i) {
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures < 10) printf("FAIL %s (%d)\n", what, i);
+  }
+}
+
+static void read_hex(const char *hex, uint8_t *buf, size_t len) {
+  size_t i;
+  for (i = 0; i < len; i++) {
+    unsigned int v;
+    sscanf(hex + 2 * i, "%2x", &v);
+    buf[i] = v;
+  }
+}
+
+#define M1 "243F6A8885A308D313198A2E03707344A4093822299F31D0082EFA98EC4E6C89"
+#define PK1 "DFF1D77F2A671C5F36183726DB2341BE58FEAE1DA2DECED843240F7B502BA659"
+
+// BIP340 test vectors 0-14: public key, message, signature, valid
+static const struct {
+  const char *pub, *msg, *sig;
+  int valid;
+} vectors[] = {
+    {"F9308A019258C31049344F85F89D5229B531C845836F99B08601F113BCE036F9",
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     "E907831F80848D1069A5371B402410364BDF1C5F8307B0084C55F1CE2DCA8215"
+     "25F66A4A85EA8B71E482A74F382D2CE5EBEEE8FDB2172F477DF4900D310536C0",
+     1},
+    {PK1, M1,
+     "6896BD60EEAE296DB48A229FF71DFE071BDE413E6D43F917DC8DCF8C78DE3341"
+     "8906D11AC976ABCCB20B091292BFF4EA897EFCB639EA871CFA95F6DE339E4B0A",
+     1},
+    {"DD308AFEC5777E13121FA72B9CC1B7CC0139715309B086C960E18FD969774EB8",
+     "7E2D58D8B3BCDF1ABADEC7829054F90DDA9805AAB56C77333024B9D0A508B75C",
+     "5831AAEED7B44BB74E5EAB94BA9D4294C49BCF2A60728D8B4C200F50DD313C1B"
+     "AB745879A5AD954A72C45A91C3A51D3C7ADEA98D82F8481E0E1E03674A6F3FB7",
+     1},
+    {"25D1DFF95105F5253C4022F628A996AD3A0D95FBF21D468A1B33F8C160D8F517",
+     "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF",
+     "7EB0509757E246F19449885651611CB965ECC1A187DD51B64FDA1EDC9637D5EC"
+     "97582B9CB13DB3933705B32BA982AF5AF25FD78881EBB32771FC5922EFC66EA3",
+     1},
+    {"D69C3509BB99E412E68B0FE8544E72837DFA30746D8BE2AA65975F29D22DC7B9",
+     "4DF3C3F68FCC83B27E9D42C90431A72499F17875C81A599B566C9889B9696703",
+     "00000000000000000000003B78CE563F89A0ED9414F5AA28AD0D96D6795F9C63"
+     "76AFB1548AF603B3EB45C9F8207DEE1060CB71C04E80F593060B07D28308D7F4",
+     1},
+    // public key not on the curve
+    {"EEFDEA4CDB677750A420FEE807EACF21EB9898AE79B9768766E4FAA04A2D4A34", M1,
+     "6CFF5C3BA86C69EA4B7376F31A9BCB4F74C1976089B2D9963DA2E5543E177769"
+     "69E89B4C5564D00349106B8497785DD7D1D713A8AE82B32FA79D5F7FC407D39B",
+     0},
+    // R has an odd y
+    {PK1, M1,
+     "FFF97BD5755EEEA420453A14355235D382F6472F8568A18B2F057A1460297556"
+     "3CC27944640AC607CD107AE10923D9EF7A73C643E166BE5EBEAFA34B1AC553E2",
+     0},
+    // negated message
+    {PK1, M1,
+     "1FA62E331EDBC21C394792D2AB1100A7B432B013DF3F6FF4F99FCB33E0E1515F"
+     "28890B3EDB6E7189B630448B515CE4F8622A954CFE545735AAEA5134FCCDB2BD",
+     0},
+    // negated s
+    {PK1, M1,
+     "6CFF5C3BA86C69EA4B7376F31A9BCB4F74C1976089B2D9963DA2E5543E177769"
+     "961764B3AA9B2FFCB6EF947B6887A226E8D7C93E00C5ED0C1834FF0D0C2E6DA6",
+     0},
+    // s * G - e * P is infinity, r = 0
+    {PK1, M1,
+     "0000000000000000000000000000000000000000000000000000000000000000"
+     "123DDA8328AF9C23A94C1FEECFD123BA4FB73476F0D594DCB65C6425BD186051",
+     0},
+    // s * G - e * P is infinity, r = 1
+    {PK1, M1,
+     "0000000000000000000000000000000000000000000000000000000000000001"
+     "7615FBAF5AE28864013C099742DEADB4DBA87F11AC6754F93780D5A1837CF197",
+     0},
+    // r is not the x coordinate of a point
+    {PK1, M1,
+     "4A298DACAE57395A15D0795DDBFD1DCB564DA82B0F269BC70A74F8220429BA1D"
+     "69E89B4C5564D00349106B8497785DD7D1D713A8AE82B32FA79D5F7FC407D39B",
+     0},
+    // r = p
+    {PK1, M1,
+     "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F"
+     "69E89B4C5564D00349106B8497785DD7D1D713A8AE82B32FA79D5F7FC407D39B",
+     0},
+    // s = n
+    {PK1, M1,
+     "6CFF5C3BA86C69EA4B7376F31A9BCB4F74C1976089B2D9963DA2E5543E177769"
+     "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141",
+     0},
+    // public key above the field size
+    {"FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC30", M1,
+     "6CFF5C3BA86C69EA4B7376F31A9BCB4F74C1976089B2D9963DA2E5543E177769"
+     "69E89B4C5564D00349106B8497785DD7D1D713A8AE82B32FA79D5F7FC407D39B",
+     0},
+};
+
+#define VECTORS (sizeof(vectors) / sizeof(vectors[0]))
+
+static void test_vectors(void) {
+  uint8_t pub[VECTORS][32], msg[VECTORS][32], sig[VECTORS][64];
+  size_t i;
+
+  for (i = 0; i < VECTORS; i++) {
+    read_hex(vectors[i].pub, pub[i], 32);
+    read_hex(vectors[i].msg, msg[i], 32);
+    read_hex(vectors[i].sig, sig[i], 64);
+    check((schnorr_verify_digest(pub[i], sig[i], msg[i]) == 0) ==
+              vectors[i].valid,
+          "BIP340 vector", i);
+    check((schnorr_verify_batch(pub[i], sig[i], msg[i], 1) == 0) ==
+              vectors[i].valid,
+          "BIP340 vector as a batch of one", i);
+  }
+  // the valid vectors 0-4 as one batch, and with each invalid one added
+  check(schnorr_verify_batch(pub[0], sig[0], msg[0], 5) == 0,
+        "BIP340 vectors 0-4 as a batch", 0);
+  for (i = 5; i < VECTORS; i++) {
+    memcpy(pub[4], pub[i], 32);
+    memcpy(msg[4], msg[i], 32);
+    memcpy(sig[4], sig[i], 64);
+    check(schnorr_verify_batch(pub[0], sig[0], msg[0], 5) != 0,
+          "BIP340 invalid vector in a batch", i);
+  }
+}
+
+// BIP340 tagged hash of data, computed from the tag
+static void tagged_hash(const char *tag, const uint8_t *data, size_t len,
+                        uint8_t *hash) {
+  uint8_t tag_hash[SHA256_DIGEST_LENGTH];
+  SHA256_CTX ctx;
+
+  sha256_Raw((const uint8_t *)tag, strlen(tag), tag_hash);
+  sha256_Init(&ctx);
+  sha256_Update(&ctx, tag_hash, sizeof(tag_hash));
+  sha256_Update(&ctx, tag_hash, sizeof(tag_hash));
+  sha256_Update(&ctx, data, len);
+  sha256_Final(&ctx, hash);
+}
+
+static void random_scalar(bignum256 *k) {
+  uint8_t buf[32];
+  do {
+    random_buffer(buf, sizeof(buf));
+    bn_read_be(buf, k);
+    bn_mod(k, &secp256k1.order);
+  } while (bn_is_zero(k));
+}
+
+// k = n - k if p has an odd y, so that k * G has an even one
+static void make_even(bignum256 *k, const curve_point *p) {
+  if (bn_is_odd(&p->y)) {
+    bn_subtract(&secp256k1.order, k, k);
+  }
+}
+
+// a BIP340 signature of msg with a random key and a random nonce
+static void sign(uint8_t *pub, uint8_t *sig, const uint8_t *msg) {
+  uint8_t buf[96];
+  bignum256 d, k, e;
+  curve_point p, r;
+
+  random_scalar(&d);
+  scalar_multiply(&secp256k1, &d, &p);
+  make_even(&d, &p);
+  random_scalar(&k);
+  scalar_multiply(&secp256k1, &k, &r);
+  make_even(&k, &r);
+
+  bn_write_be(&r.x, buf);
+  bn_write_be(&p.x, buf + 32);
+  memcpy(buf + 64, msg, 32);
+  tagged_hash("BIP0340/challenge", buf, sizeof(buf), buf);
+  bn_read_be(buf, &e);
+  bn_mod(&e, &secp256k1.order);
+
+  // s = k + e * d
+  bn_multiply(&d, &e, &secp256k1.order);
+  bn_addmod(&e, &k, &secp256k1.order);
+  bn_mod(&e, &secp256k1.order);
+  memcpy(pub, buf + 32, 32);
+  bn_write_be(&r.x, sig);
+  bn_write_be(&e, sig + 32);
+}
+
+static void test_batch(void) {
+  const size_t sizes[] = {1,
+                          2,
+                          SCHNORR_VERIFY_BATCH_SIZE - 1,
+                          SCHNORR_VERIFY_BATCH_SIZE,
+                          SCHNORR_VERIFY_BATCH_SIZE + 1,
+                          2 * SCHNORR_VERIFY_BATCH_SIZE + 3};
+  const size_t max = 2 * SCHNORR_VERIFY_BATCH_SIZE + 3;
+  uint8_t *pub = malloc(32 * max), *msg = malloc(32 * max),
+          *sig = malloc(64 * max);
+  size_t s, i, j, n, positions[4];
+  int what;
+
+  if (pub == NULL || msg == NULL || sig == NULL) exit(1);
+  for (i = 0; i < max; i++) {
+    random_buffer(msg + 32 * i, 32);
+    sign(pub + 32 * i, sig + 64 * i, msg + 32 * i);
+    check(schnorr_verify_digest(pub + 32 * i, sig + 64 * i, msg + 32 * i) ==
+              0,
+          "signature made here", i);
+  }
+
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    n = sizes[s];
+    check(schnorr_verify_batch(pub, sig, msg, n) == 0, "valid batch", n);
+
+    // the first, a middle and the last signature, and the first one of
+    // the last chunk
+    positions[0] = 0;
+    positions[1] = n / 2;
+    positions[2] = n - 1;
+    positions[3] = (n - 1) / SCHNORR_VERIFY_BATCH_SIZE *
+                   SCHNORR_VERIFY_BATCH_SIZE;
+    for (j = 0; j < 4; j++) {
+      i = positions[j];
+      // a bit of s, of r, of the message and of the public key
+      for (what = 0; what < 4; what++) {
+        uint8_t *byte = what == 0   ? sig + 64 * i + 63
+                        : what == 1 ? sig + 64 * i + 31
+                        : what == 2 ? msg + 32 * i + 5
+                                    : pub + 32 * i + 31;
+        *byte ^= 1;
+        check(schnorr_verify_batch(pub, sig, msg, n) != 0, "tampered batch",
+              (int)(n * 100 + i * 4 + what));
+        *byte ^= 1;
+      }
+    }
+    check(schnorr_verify_batch(pub, sig, msg, n) == 0, "restored batch", n);
+  }
+
+  // a valid signature of another message
+  memcpy(sig + 64 * max - 64, sig, 64);
+  check(schnorr_verify_batch(pub, sig, msg, max) != 0, "copied signature",
+        0);
+  free(pub);
+  free(msg);
+  free(sig);
+}
+
+// res = sum k[i] * p[i] with point_multiply and point_add
+static void multi_expected(const bignum256 *k, const curve_point *p,
+                           size_t n, curve_point *res) {
+  curve_point q;
+  size_t i;
+
+  point_set_infinity(res);
+  for (i = 0; i < n; i++) {
+    point_multiply(&secp256k1, &k[i], &p[i], &q);
+    point_add(&secp256k1, &q, res);
+  }
+}
+
+static void check_multi(const bignum256 *k, const curve_point *p, size_t n,
+                        const char *what, int i) {
+  curve_point r1, r2;
+  point_multiply_multi(&secp256k1, k, p, n, &r1);
+  multi_expected(k, p, n, &r2);
+  check(point_is_equal(&r1, &r2) ||
+            (point_is_infinity(&r1) && point_is_infinity(&r2)),
+        what, i);
+}
+
+#define MULTI_MAX 160
+
+static void test_multi(int rounds) {
+  const size_t sizes[] = {1, 2, 3, 7, 16, 33, 100, MULTI_MAX};
+  bignum256 k[MULTI_MAX];
+  curve_point p[MULTI_MAX];
+  size_t s, i, n;
+  int round;
+
+  for (i = 0; i < MULTI_MAX; i++) {
+    random_scalar(&k[i]);
+    scalar_multiply(&secp256k1, &k[i], &p[i]);
+  }
+
+  for (round = 0; round < rounds; round++) {
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      n = sizes[s];
+      for (i = 0; i < n; i++) {
+        random_scalar(&k[i]);
+        // short scalars, which take fewer windows, and zeros
+        if (round % 3 == 1) {
+          k[i].val[4] = k[i].val[5] = k[i].val[6] = 0;
+          k[i].val[7] = k[i].val[8] = 0;
+        }
+        if (round % 3 == 2 && i % 5 == 0) bn_zero(&k[i]);
+      }
+      check_multi(k, p, n, "random scalars", (int)n);
+    }
+  }
+
+  // p and -p with the same scalars: every bucket the pair lands in sums
+  // to infinity on the way, and a third point keeps the total finite
+  for (n = 3; n <= 99; n += 32) {
+    for (i = 0; i + 1 < n; i += 2) {
+      random_scalar(&k[i]);
+      k[i + 1] = k[i];
+      p[i + 1] = p[i];
+      bn_subtract(&secp256k1.prime, &p[i].y, &p[i + 1].y);
+    }
+    random_scalar(&k[n - 1]);
+    check_multi(k, p, n, "p and -p", (int)n);
+    // without the third point the sum is infinity
+    check_multi(k, p, n - 1, "p and -p only", (int)n);
+  }
+
+  // p twice with k and n - k, and with equal scalars so that buckets
+  // double
+  random_scalar(&k[0]);
+  bn_subtract(&secp256k1.order, &k[0], &k[1]);
+  p[1] = p[0];
+  check_multi(k, p, 2, "k p + (n - k) p", 0);
+  k[1] = k[0];
+  check_multi(k, p, 2, "k p + k p", 0);
+  bn_read_uint32(1, &k[0]);
+  bn_read_uint32(1, &k[1]);
+  check_multi(k, p, 2, "p + p", 0);
+}
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 6;
+
+  random_reseed(1);
+  test_vectors();
+  test_batch();
+  test_multi(rounds);
+  printf("test_schnorr (batch size %d): %d checks, %d failures\n",
+         SCHNORR_VERIFY_BATCH_SIZE, checks, failures);
+  return failures != 0;
+}
@@ -0,0 +1,135 @@
+// This program checks scalar_sequence_next and
+// ecdsa_get_public_key{33,65}_sequence against scalar_multiply of each
+// k + i.  The sequences start at n - 2, n - 1, 0 and 1, where the point
+// addition cannot be used and the sequence restarts, wrap around the
+// group order and are read in chunks below, at and above
+// SCALAR_MULTIPLY_BATCH_SIZE.
+//
+// Usage: test_sequence [random starts]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "memzero.h"
+#include "rand.h"
+#include "secp256k1.h"
+
+#define POINTS (4 * SCALAR_MULTIPLY_BATCH_SIZE + 3)
+
+static int checks, failures;
+
+static void check(int ok, const char *what, int i) {
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures < 10) printf("FAIL %s (%d)\n", what, i);
+  }
+}
+
+static int same_point(const curve_point *a, const curve_point *b) {
+  return point_is_equal(a, b) ||
+         (point_is_infinity(a) && point_is_infinity(b));
+}
+
+// expected[i] = (k + i) * G, with k + i modulo the group order
+static void expected_points(const bignum256 *k, curve_point *expected) {
+  bignum256 ki = *k;
+  int i;
+
+  for (i = 0; i < POINTS; i++) {
+    scalar_multiply(&secp256k1, &ki, &expected[i]);
+    bn_addi(&ki, 1);
+    bn_mod(&ki, &secp256k1.order);
+  }
+}
+
+// reads POINTS points from a sequence at k in chunks of chunk points
+static void check_sequence(const bignum256 *k, const curve_point *expected,
+                           size_t chunk, const char *what) {
+  scalar_sequence seq;
+  curve_point res[POINTS];
+  size_t i, m;
+
+  scalar_sequence_init(&seq, &secp256k1, k);
+  for (i = 0; i < POINTS; i += m) {
+    m = POINTS - i < chunk ? POINTS - i : chunk;
+    scalar_sequence_next(&seq, res + i, m);
+  }
+  for (i = 0; i < POINTS; i++) {
+    check(same_point(&res[i], &expected[i]), what, (int)(chunk * 1000 + i));
+  }
+  memzero(&seq, sizeof(seq));
+}
+
+// ecdsa_get_public_key{33,65}_sequence writes the keys like
+// ecdsa_get_public_key{33,65} would for each point
+static void check_public_keys(const bignum256 *k, const curve_point *expected,
+                              const char *what) {
+  static uint8_t pub33[POINTS * 33], pub65[POINTS * 65];
+  uint8_t priv[32], pub[65];
+  int i;
+
+  bn_write_be(k, priv);
+  ecdsa_get_public_key33_sequence(&secp256k1, priv, POINTS, pub33);
+  ecdsa_get_public_key65_sequence(&secp256k1, priv, POINTS, pub65);
+  for (i = 0; i < POINTS; i++) {
+    compress_coords(&expected[i], pub);
+    check(memcmp(pub33 + 33 * i, pub, 33) == 0, what, i);
+    pub[0] = 0x04;
+    bn_write_be(&expected[i].x, pub + 1);
+    bn_write_be(&expected[i].y, pub + 33);
+    check(memcmp(pub65 + 65 * i, pub, 65) == 0, what, i);
+  }
+  memzero(priv, sizeof(priv));
+}
+
+static void test_start(const bignum256 *k, const char *what) {
+  static const size_t chunks[] = {1,
+                                  2,
+                                  SCALAR_MULTIPLY_BATCH_SIZE - 1,
+                                  SCALAR_MULTIPLY_BATCH_SIZE,
+                                  SCALAR_MULTIPLY_BATCH_SIZE + 1,
+                                  2 * SCALAR_MULTIPLY_BATCH_SIZE + 5,
+                                  POINTS};
+  curve_point expected[POINTS];
+  size_t i;
+
+  expected_points(k, expected);
+  for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+    check_sequence(k, expected, chunks[i], what);
+  }
+  check_public_keys(k, expected, what);
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 4;
+  bignum256 k;
+  uint8_t buf[32];
+  int i;
+
+  random_reseed(1);
+
+  bn_read_uint32(2, &k);
+  bn_subtract(&secp256k1.order, &k, &k);
+  test_start(&k, "start n - 2");
+  bn_read_uint32(1, &k);
+  bn_subtract(&secp256k1.order, &k, &k);
+  test_start(&k, "start n - 1");
+  bn_zero(&k);
+  test_start(&k, "start 0");
+  bn_one(&k);
+  test_start(&k, "start 1");
+
+  for (i = 0; i < n; i++) {
+    random_buffer(buf, sizeof(buf));
+    bn_read_be(buf, &k);
+    bn_mod(&k, &secp256k1.order);
+    test_start(&k, "random start");
+  }
+
+  printf("test_sequence: %d checks, %d failures\n", checks, failures);
+  return failures != 0;
+}
@@ -0,0 +1,184 @@
+// This program checks ecdsa_sign_digest and ecdsa_sign_digest_key against
+// RFC 6979 known answers for secp256k1 with SHA-256 and low s.  The
+// signatures with the third nonce are what is_canonical gets after
+// rejecting the first two, they exercise the deferred update of step h.3
+// in generate_k_rfc6979.  Both functions must also agree for random keys,
+// with one rfc6979_key reused for several digests.
+//
+// Usage: test_sign [keys]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ecdsa.h"
+#include "memzero.h"
+#include "rand.h"
+#include "rfc6979.h"
+#include "secp256k1.h"
+#include "sha2.h"
+
+static int checks, failures;
+
+static void check(int ok, const char *what, int i) {
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures < 10) printf("FAIL %s (%d)\n", what, i);
+  }
+}
+
+static void read_hex(const char *hex, uint8_t *buf, size_t len) {
+  size_t i;
+  for (i = 0; i < len; i++) {
+    unsigned int v;
+    sscanf(hex + 2 * i, "%2x", &v);
+    buf[i] = v;
+  }
+}
+
+// private key, message (NULL for the digest 0xff..ff), r || s and the
+// recovery byte with the first nonce and with the third one.  The first
+// ones are the usual secp256k1 RFC 6979 vectors, the third nonce ones
+// come from a separate Python implementation of RFC 6979.
+static const struct {
+  const char *priv, *msg;
+  const char *sig;
+  uint8_t by;
+  const char *sig3;
+  uint8_t by3;
+} vectors[] = {
+    {"0000000000000000000000000000000000000000000000000000000000000001",
+     "Satoshi Nakamoto",
+     "934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d8"
+     "2442ce9d2b916064108014783e923ec36b49743e2ffa1c4496f01a512aafd9e5",
+     1,
+     "1ef5968bd51f209a151f92046fda0ee306df5cd8a7c0b66a2ae398768dca9fb6"
+     "54b1a137b7af2d3be85091aa81a402a1ccb86c27b3b404b5577b798e79da712f",
+     1},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "Satoshi Nakamoto",
+     "fd567d121db66e382991534ada77a6bd3106f0a1098c231e47993447cd6af2d0"
+     "6b39cd0eb1bc8603e159ef5c20a5c8ad685a45b06ce9bebed3f153d10d93bed5",
+     0,
+     "8cf63c39c9c9eb58fb2b0056871457804b038792ba244f96a827245143f844fa"
+     "04cbd9bdc9a042b35603feaaa1e8e2279cfd6e5758b4e87dd67dbd14abffe4a8",
+     0},
+    {"f8b8af8ce3c7cca5e300d33939540c10d45ce001b8f252bfbc57ba0342904181",
+     "Alan Turing",
+     "7063ae83e7f62bbb171798131b4a0564b956930092b33b07b395615d9ec7e15c"
+     "58dfcc1e00a35e1572f366ffe34ba0fc47db1e7189759b9fb233c5b05ab388ea",
+     0,
+     "9584de59864184cd650784f9ec488e8c299512c6be6a82535ad7c376b3d17778"
+     "429f29d8d68e33a7804849870269504ebbddf237dc4c9a531891b31a29c2ee6e",
+     1},
+    {"0000000000000000000000000000000000000000000000000000000000000001",
+     "All those moments will be lost in time, like tears in rain. Time to "
+     "die...",
+     "8600dbd41e348fe5c9465ab92d23e3db8b98b873beecd930736488696438cb6b"
+     "547fe64427496db33bf66019dacbf0039c04199abb0122918601db38a72cfc21",
+     0,
+     "e6aa54d4f8f89b5a668239aadb4a802bc9ab2d45bb7767585447ef4ef9039add"
+     "509ea17b30d09a01ee38eac72078703bdeded97cfc09dfbcadd7900257750f0f",
+     0},
+    // a digest above the group order, reduced by bits2octets
+    {"0000000000000000000000000000000000000000000000000000000000000001",
+     NULL,
+     "7cb38cc5712e9e11a767615f6080dbc111c9cdd613eb98999fd92a86bafd4540"
+     "7923ca1f4d03471d2866f776ef8a6d3cac099b427331aeb245aa9dafeddcf115",
+     0,
+     "be80eb018e06960bcbc6b6df954abaa0a3f0e1337ed5600b6bb9cb7f6fb81862"
+     "63f30e59fe4a259a0e4d0282a0aa1695f7a83520e8860d23ace2d99a727dd617",
+     1},
+};
+
+// rejects the first two signatures it is asked about
+static int rejected;
+
+static int reject_two(uint8_t by, uint8_t sig[64]) {
+  (void)by;
+  (void)sig;
+  return rejected++ >= 2;
+}
+
+static void test_vectors(void) {
+  uint8_t priv[32], digest[32], expected[64], sig[64], by;
+  rfc6979_key key;
+  size_t i;
+
+  for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+    read_hex(vectors[i].priv, priv, 32);
+    if (vectors[i].msg != NULL) {
+      sha256_Raw((const uint8_t *)vectors[i].msg, strlen(vectors[i].msg),
+                 digest);
+    } else {
+      memset(digest, 0xff, sizeof(digest));
+    }
+    init_rfc6979_key(priv, &key);
+
+    read_hex(vectors[i].sig, expected, 64);
+    by = 0xff;
+    check(ecdsa_sign_digest(&secp256k1, priv, digest, sig, &by, NULL) == 0 &&
+              memcmp(sig, expected, 64) == 0 && by == vectors[i].by,
+          "ecdsa_sign_digest", i);
+    by = 0xff;
+    check(ecdsa_sign_digest_key(&secp256k1, &key, digest, sig, &by, NULL) ==
+                  0 &&
+              memcmp(sig, expected, 64) == 0 && by == vectors[i].by,
+          "ecdsa_sign_digest_key", i);
+
+    read_hex(vectors[i].sig3, expected, 64);
+    rejected = 0;
+    by = 0xff;
+    check(ecdsa_sign_digest(&secp256k1, priv, digest, sig, &by,
+                            reject_two) == 0 &&
+              memcmp(sig, expected, 64) == 0 && by == vectors[i].by3 &&
+              rejected == 3,
+          "ecdsa_sign_digest, third nonce", i);
+    rejected = 0;
+    by = 0xff;
+    check(ecdsa_sign_digest_key(&secp256k1, &key, digest, sig, &by,
+                                reject_two) == 0 &&
+              memcmp(sig, expected, 64) == 0 && by == vectors[i].by3 &&
+              rejected == 3,
+          "ecdsa_sign_digest_key, third nonce", i);
+  }
+  memzero(&key, sizeof(key));
+}
+
+// ecdsa_sign_digest_key with one key state for several digests must
+// sign exactly like ecdsa_sign_digest
+static void test_random(int n) {
+  uint8_t priv[32], digest[32], sig1[64], sig2[64], by1, by2;
+  rfc6979_key key;
+  bignum256 k;
+  int i, j;
+
+  for (i = 0; i < n; i++) {
+    do {
+      random_buffer(priv, sizeof(priv));
+      bn_read_be(priv, &k);
+    } while (bn_is_zero(&k) || !bn_is_less(&k, &secp256k1.order));
+    init_rfc6979_key(priv, &key);
+    for (j = 0; j < 4; j++) {
+      random_buffer(digest, sizeof(digest));
+      check(ecdsa_sign_digest(&secp256k1, priv, digest, sig1, &by1, NULL) ==
+                    0 &&
+                ecdsa_sign_digest_key(&secp256k1, &key, digest, sig2, &by2,
+                                      NULL) == 0 &&
+                memcmp(sig1, sig2, 64) == 0 && by1 == by2,
+            "ecdsa_sign_digest_key = ecdsa_sign_digest", i);
+    }
+  }
+  memzero(&key, sizeof(key));
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 200;
+
+  random_reseed(1);
+  test_vectors();
+  test_random(n);
+  printf("test_sign: %d checks, %d failures\n", checks, failures);
+  return failures != 0;
+}
@@ -0,0 +1,262 @@
+// This program checks the taproot (P2TR) address path: the BIP341 key
+// tweak, bech32m and segwit address encoding against the BIP86 and
+// BIP350 test vectors, and private keys to addresses through
+// taproot_address_from_privkey and the module's taproot pipeline.  The
+// addresses of the keys other than the BIP86 one come from a separate
+// Python implementation of BIP340/341/350.
+//
+// Usage: test_taproot
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+#include "schnorr.h"
+#include "secp256k1.h"
+#include "segwit_addr.h"
+
+// not in a header, see __init__.c
+int taproot_address_from_privkey(const unsigned char privkey[32],
+                                 const char *hrp, unsigned char address[63]);
+int shared_modules_bitaddr_get_address_privkey_taproot(
+    unsigned char *address, unsigned char *privkey,
+    const char *entropy_privkey, const char *entropy_ecdsa);
+
+static int checks, failures;
+
+static void check(int ok, const char *what, const char *vector) {
+  checks++;
+  if (!ok) {
+    failures++;
+    printf("FAIL %s: %s\n", what, vector);
+  }
+}
+
+static void read_hex(const char *hex, uint8_t *buf, size_t len) {
+  size_t i;
+  for (i = 0; i < len; i++) {
+    unsigned int v;
+    sscanf(hex + 2 * i, "%2x", &v);
+    buf[i] = v;
+  }
+}
+
+static void lower(const char *in, char *out) {
+  while ((*out++ = tolower((unsigned char)*in++)) != '\0') {
+  }
+}
+
+// BIP86, m/86'/0'/0'/0/0
+static void test_bip86(void) {
+  const char *address =
+      "bc1p5cyxnuxmeuwuvkwfem96lqzszd02n6xdcjrs20cac6yqjjwudpxqkedrcr";
+  uint8_t priv[32], internal[32], output[32], key[32];
+  char out[91];
+
+  read_hex("41f41d69260df4cf277826a9b65a3717e4eeddbeedf637f212ca096576479361",
+           priv, 32);
+  read_hex("cc8a4bc64d897bddc5fbc2f670f7a8ba0b386779106cf1223c6fc5d7cd6fc115",
+           internal, 32);
+  read_hex("a60869f0dbcf1dc659c9cecbaf8050135ea9e8cdc487053f1dc6880949dc684c",
+           output, 32);
+
+  schnorr_get_public_key(priv, key);
+  check(memcmp(key, internal, 32) == 0, "internal key", "BIP86");
+  check(schnorr_tweak_public_key(internal, key) &&
+            memcmp(key, output, 32) == 0,
+        "tweaked internal key", "BIP86");
+  memset(key, 0, sizeof(key));
+  check(schnorr_get_tweaked_public_key(priv, key) &&
+            memcmp(key, output, 32) == 0,
+        "tweaked private key", "BIP86");
+  check(segwit_addr_encode(out, "bc", 1, output, 32) &&
+            strcmp(out, address) == 0,
+        "output key address", "BIP86");
+  memset(out, 0, sizeof(out));
+  check(taproot_address_from_privkey(priv, "bc", (unsigned char *)out) &&
+            strcmp(out, address) == 0,
+        "taproot_address_from_privkey", "BIP86");
+}
+
+static const char *bech32m_valid[] = {
+    "A1LQFN3A",
+    "a1lqfn3a",
+    "an83characterlonghumanreadablepartthatcontainsthetheexcludedcharacte"
+    "rsbioandnumber11sg7hg6",
+    "abcdef1l7aum6echk45nj3s0wdvt2fg8x9yrzpqzd3ryx",
+    "11llllllllllllllllllllllllllllllllllllllllllllllllllllllllllllllllll"
+    "llllllllllllllllludsr8",
+    "split1checkupstagehandshakeupstreamerranterredcaperredlc445v",
+    "?1v759aa",
+};
+
+static const char *bech32m_invalid[] = {
+    "\x20" "1xj0phk",
+    "\x7f" "1g6xzxy",
+    "\x80" "1vctc34",
+    "an84characterslonghumanreadablepartthatcontainsthetheexcludedcharact"
+    "ersbioandnumber11d6pts4",
+    "qyrz8wqd2c9m",
+    "1qyrz8wqd2c9m",
+    "y1b0jsk6g",
+    "lt1igcx5c0",
+    "in1muywd",
+    "mm1crxm3i",
+    "au1s5cgom",
+    "M1VUXWEZ",
+    "16plkw9",
+    "1p2gdwpf",
+};
+
+// BIP350 bech32m strings, which must decode and encode back in lower case
+static void test_bech32m(void) {
+  char hrp[91], out[91], low[91];
+  uint8_t data[90];
+  size_t len, i;
+
+  for (i = 0; i < sizeof(bech32m_valid) / sizeof(bech32m_valid[0]); i++) {
+    const char *v = bech32m_valid[i];
+    check(bech32_decode(hrp, data, &len, v) == BECH32_ENCODING_BECH32M,
+          "valid bech32m", v);
+    lower(v, low);
+    check(bech32_encode(out, hrp, data, len, BECH32_ENCODING_BECH32M) &&
+              strcmp(out, low) == 0,
+          "bech32m round trip", v);
+  }
+  for (i = 0; i < sizeof(bech32m_invalid) / sizeof(bech32m_invalid[0]); i++) {
+    check(bech32_decode(hrp, data, &len, bech32m_invalid[i]) ==
+              BECH32_ENCODING_NONE,
+          "invalid bech32m", bech32m_invalid[i]);
+  }
+}
+
+// BIP350 segwit addresses with their scriptPubKey
+static const char *address_valid[][2] = {
+    {"BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4",
+     "0014751e76e8199196d454941c45d1b3a323f1433bd6"},
+    {"tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sl5k7",
+     "00201863143c14c5166804bd19203356da136c985678cd4d27a1b8c6329604903262"},
+    {"bc1pw508d6qejxtdg4y5r3zarvary0c5xw7kw508d6qejxtdg4y5r3zarvary0c5xw7kt5"
+     "nd6y",
+     "5128751e76e8199196d454941c45d1b3a323f1433bd6751e76e8199196d454941c45d1b"
+     "3a323f1433bd6"},
+    {"BC1SW50QGDZ25J", "6002751e"},
+    {"bc1zw508d6qejxtdg4y5r3zarvaryvaxxpcs",
+     "5210751e76e8199196d454941c45d1b3a323"},
+    {"tb1qqqqqp399et2xygdj5xreqhjjvcmzhxw4aywxecjdzew6hylgvsesrxh6hy",
+     "0020000000c4a5cad46221b2a187905e5266362b99d5e91c6ce24d165dab93e86433"},
+    {"tb1pqqqqp399et2xygdj5xreqhjjvcmzhxw4aywxecjdzew6hylgvsesf3hn0c",
+     "5120000000c4a5cad46221b2a187905e5266362b99d5e91c6ce24d165dab93e86433"},
+    {"bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0",
+     "512079be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"},
+};
+
+static const char *address_invalid[] = {
+    "tc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vq5zuyut",
+    "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqh2y7hd",
+    "tb1z0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqglt7rf",
+    "BC1S0XLXVLHEMJA6C4DQV22UAPCTQUPFHLXM9H8Z3K2E72Q4K9HCZ7VQ54WELL",
+    "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kemeawh",
+    "tb1q0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vq24jc47",
+    "bc1p38j9r5y49hruaue7wxjce0updqjuyyx0kh56v8s25huc6995vvpql3jow4",
+    "BC130XLXVLHEMJA6C4DQV22UAPCTQUPFHLXM9H8Z3K2E72Q4K9HCZ7VQ7ZWS8R",
+    "bc1pw5dgrnzv",
+    "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7v8n0nx0muaewav253"
+    "zgeav",
+    "BC1QR508D6QEJXTDG4Y5R3ZARVARYV98GJ9P",
+    "tb1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vq47Zagq",
+    "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7v07qwwzcrf",
+    "tb1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vpggkg4j",
+    "bc1gmk9yu",
+};
+
+static void test_addresses(void) {
+  char hrp[3], out[91], low[91];
+  uint8_t prog[40], script[42];
+  size_t len, i;
+  int ver;
+
+  for (i = 0; i < sizeof(address_valid) / sizeof(address_valid[0]); i++) {
+    const char *v = address_valid[i][0];
+    lower(v, low);
+    memcpy(hrp, low, 2);
+    hrp[2] = '\0';
+    if (!segwit_addr_decode(&ver, prog, &len, hrp, v)) {
+      check(0, "valid address", v);
+      continue;
+    }
+    read_hex(address_valid[i][1], script, strlen(address_valid[i][1]) / 2);
+    check(script[0] == (ver ? 0x50 + ver : 0) && script[1] == len &&
+              2 + len == strlen(address_valid[i][1]) / 2 &&
+              memcmp(script + 2, prog, len) == 0,
+          "scriptPubKey", v);
+    check(segwit_addr_encode(out, hrp, ver, prog, len) &&
+              strcmp(out, low) == 0,
+          "address round trip", v);
+  }
+  for (i = 0; i < sizeof(address_invalid) / sizeof(address_invalid[0]); i++) {
+    const char *v = address_invalid[i];
+    check(!segwit_addr_decode(&ver, prog, &len, "bc", v) &&
+              !segwit_addr_decode(&ver, prog, &len, "tb", v),
+          "invalid address", v);
+  }
+}
+
+// private keys to addresses.  n - 1 has the x-only key of 1, so the same
+// address.
+static const char *key_address[][2] = {
+    {"0000000000000000000000000000000000000000000000000000000000000001",
+     "bc1pmfr3p9j00pfxjh0zmgp99y8zftmd3s5pmedqhyptwy6lm87hf5sspknck9"},
+    {"0000000000000000000000000000000000000000000000000000000000000002",
+     "bc1pet7ep3czdu9k4wvdlz2fp5p8x2yp7t6ttyqg2c6cmh0lgeuu9lasmp9hsg"},
+    {"0000000000000000000000000000000000000000000000000000000000000003",
+     "bc1pgxxyvcmdncdxs06cudd5yvmwwahaesaj6n3eu7st7x4sw9hrchaqjy33gs"},
+    {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140",
+     "bc1pmfr3p9j00pfxjh0zmgp99y8zftmd3s5pmedqhyptwy6lm87hf5sspknck9"},
+};
+
+static void test_keys(void) {
+  unsigned char address[70], privkey[70];
+  uint8_t priv[32];
+  size_t i;
+
+  for (i = 0; i < sizeof(key_address) / sizeof(key_address[0]); i++) {
+    read_hex(key_address[i][0], priv, 32);
+    memset(address, 0, sizeof(address));
+    check(taproot_address_from_privkey(priv, "bc", address) &&
+              strcmp((char *)address, key_address[i][1]) == 0,
+          "key to address", key_address[i][0]);
+  }
+
+  // zero and the group order are not keys
+  memset(priv, 0, sizeof(priv));
+  check(!taproot_address_from_privkey(priv, "bc", address), "invalid key",
+        "0");
+  bn_write_be(&secp256k1.order, priv);
+  check(!taproot_address_from_privkey(priv, "bc", address), "invalid key",
+        "n");
+
+  // the pipeline, private key sha256("ubitaddr taproot test")
+  memset(address, 0, sizeof(address));
+  memset(privkey, 0, sizeof(privkey));
+  check(shared_modules_bitaddr_get_address_privkey_taproot(
+            address, privkey, "ubitaddr taproot test", "ecdsa entropy") &&
+            strcmp((char *)address,
+                   "bc1p52kedlxvr640qyxmpnctzrf2l062tzrvvustvd03mezcrfaa5tys"
+                   "vc0j6l") == 0 &&
+            strcmp((char *)privkey,
+                   "L4fnNWSoDwTT5JVoFrtTgf6tAmX5zdCZZgRuv8xBvaq4XZktkEgk") ==
+                0,
+        "taproot pipeline", "ubitaddr taproot test");
+}
+
+int main(void) {
+  test_bip86();
+  test_bech32m();
+  test_addresses();
+  test_keys();
+  printf("test_taproot: %d checks, %d failures\n", checks, failures);
+  return failures != 0;
+}
@@ -0,0 +1,136 @@
+// This program computes the same public keys, point multiplications and
+// signatures in several threads at once and checks that every thread
+// gets the results of a single threaded run.  It also checks that the
+// threads' random32() contexts, which blind the point multiplications,
+// are seeded differently.
+//
+// Usage: test_threads [threads] [rounds]
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "rand.h"
+#include "secp256k1.h"
+
+#define KEYS 64
+#define MAX_THREADS 64
+
+typedef struct {
+  uint8_t pub65[KEYS][65];
+  uint8_t pub33_batch[KEYS][33];
+  uint8_t sig[KEYS][64];
+  curve_point mult[KEYS];
+} results;
+
+static uint8_t priv[KEYS][32];
+static results expected;
+
+typedef struct {
+  int rounds;
+  uint32_t first_random;
+  int mismatches;
+} job;
+
+static void compute(results *r) {
+  bignum256 k;
+  curve_point p;
+  int i;
+
+  ecdsa_get_public_key33_batch(&secp256k1, &priv[0][0], KEYS,
+                               &r->pub33_batch[0][0]);
+  for (i = 0; i < KEYS; i++) {
+    ecdsa_get_public_key65(&secp256k1, priv[i], r->pub65[i]);
+  }
+  for (i = 0; i < KEYS; i++) {
+    // the digest is the next key, anything will do
+    ecdsa_sign_digest(&secp256k1, priv[i], priv[(i + 1) % KEYS], r->sig[i],
+                      NULL, NULL);
+    bn_read_be(priv[i], &k);
+    if (ecdsa_read_pubkey(&secp256k1, r->pub65[(i + 1) % KEYS], &p)) {
+      point_multiply(&secp256k1, &k, &p, &r->mult[i]);
+    } else {
+      point_set_infinity(&r->mult[i]);
+    }
+  }
+}
+
+static int compare(const results *r) {
+  int i, bad = 0;
+  for (i = 0; i < KEYS; i++) {
+    bad += memcmp(r->pub65[i], expected.pub65[i], 65) != 0;
+    bad += memcmp(r->pub33_batch[i], expected.pub33_batch[i], 33) != 0;
+    bad += memcmp(r->sig[i], expected.sig[i], 64) != 0;
+    bad += !point_is_equal(&r->mult[i], &expected.mult[i]);
+  }
+  return bad;
+}
+
+static void *run(void *arg) {
+  job *j = arg;
+  results *r = malloc(sizeof(results));
+  int i;
+
+  j->first_random = random32();
+  for (i = 0; i < j->rounds; i++) {
+    memset(r, 0, sizeof(results));
+    compute(r);
+    j->mismatches += compare(r);
+  }
+  free(r);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  int threads = argc > 1 ? atoi(argv[1]) : 8;
+  int rounds = argc > 2 ? atoi(argv[2]) : 3;
+  pthread_t tid[MAX_THREADS];
+  job jobs[MAX_THREADS];
+  bignum256 k;
+  int i, j, checks = 0, failures = 0;
+
+  if (threads < 1 || threads > MAX_THREADS) {
+    printf("usage: test_threads [threads <= %d] [rounds]\n", MAX_THREADS);
+    return 1;
+  }
+  random_reseed(1);
+  for (i = 0; i < KEYS; i++) {
+    do {
+      random_buffer(priv[i], 32);
+      bn_read_be(priv[i], &k);
+    } while (bn_is_zero(&k) || !bn_is_less(&k, &secp256k1.order));
+  }
+  compute(&expected);
+
+  memset(jobs, 0, sizeof(jobs));
+  for (i = 0; i < threads; i++) {
+    jobs[i].rounds = rounds;
+    if (pthread_create(&tid[i], NULL, run, &jobs[i]) != 0) {
+      printf("cannot start thread %d\n", i);
+      return 1;
+    }
+  }
+  for (i = 0; i < threads; i++) {
+    pthread_join(tid[i], NULL);
+    checks++;
+    if (jobs[i].mismatches != 0) {
+      failures++;
+      printf("FAIL thread %d: %d results differ\n", i, jobs[i].mismatches);
+    }
+    for (j = 0; j < i; j++) {
+      checks++;
+      if (jobs[i].first_random == jobs[j].first_random) {
+        failures++;
+        printf("FAIL threads %d and %d share their random32 sequence\n", j,
+               i);
+      }
+    }
+  }
+
+  printf("test_threads (%d threads, %d rounds): %d checks, %d failures\n",
+         threads, rounds, checks, failures);
+  return failures != 0;
+}